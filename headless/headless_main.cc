@@ -0,0 +1,327 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+// Runs TwoDimWorldScene without a window and reports how long each part of
+// "TwoDimWorldScene::update(...)" took. Build with "make headless" and run from
+// the repository root so Moonscript is found in "assets_embed".
+
+// third party includes
+extern "C" {
+#include <lauxlib.h>
+#include <lua.h>
+}
+
+// standard library includes
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <format>
+#include <memory>
+#include <new>
+#include <optional>
+#include <print>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// local includes
+#include "2d_world_scene.h"
+#include "scene_system.h"
+#include "timing_stats.h"
+#include "vertex_transform.h"
+
+namespace {
+
+constexpr int DEFAULT_FRAME_COUNT = 600;
+constexpr float DEFAULT_FRAME_DT = 1.0F / 60.0F;
+
+struct RunnerArgs {
+  int frame_count;
+  float frame_dt;
+  int thread_count;
+  std::optional<uint32_t> seed;
+  // Lua file run after the default script, before the scene is created.
+  std::optional<std::string> lua_script;
+  // Recording fed to the scene instead of (absent) keyboard input.
+  std::optional<std::string> replay;
+  // Calls per "scene_2d.getballpos" microbenchmark, 0 skips it.
+  int lua_call_count;
+  // Run the self checks instead of the timed updates.
+  bool check;
+};
+
+void print_usage(const char *name) {
+  std::println(
+      stdout,
+      "Usage: {} [--frames N] [--dt SECONDS] [--threads N] [--seed N]\n"
+      "          [--lua FILE] [--replay FILE] [--lua-calls N] [--check]\n"
+      "  --frames   Updates to run (default {}).\n"
+      "  --dt       Delta-time passed to every update (default 1/60).\n"
+      "             Replays use their recorded delta-time instead.\n"
+      "  --threads  Box2D solver threads including the main thread.\n"
+      "  --seed     Seed for spawn positions and colors.\n"
+      "  --lua      Lua file run before the scene is created.\n"
+      "  --replay   Input recording made with \"scene_2d.startrecording\".\n"
+      "             Only matches if the script state does too.\n"
+      "  --lua-calls  Afterwards time N \"scene_2d.getballpos\" calls against\n"
+      "             the old per-call shared_ptr binding.\n"
+      "  --check    Run self checks instead, exit nonzero if any fails.",
+      name, DEFAULT_FRAME_COUNT);
+}
+
+std::optional<RunnerArgs> parse_args(int argc, char **argv) {
+  RunnerArgs args{DEFAULT_FRAME_COUNT, DEFAULT_FRAME_DT, 1, std::nullopt,
+                  std::nullopt, std::nullopt, 0, false};
+  for (int idx = 1; idx < argc; ++idx) {
+    const std::string_view arg = argv[idx];
+    if (arg == "--check") {
+      args.check = true;
+      continue;
+    } else if (arg == "-h" || arg == "--help" || idx + 1 >= argc) {
+      return std::nullopt;
+    }
+    const char *value = argv[++idx];
+    if (arg == "--frames") {
+      args.frame_count = std::max(1, std::atoi(value));
+    } else if (arg == "--dt") {
+      args.frame_dt = std::strtof(value, nullptr);
+      if (args.frame_dt <= 0.0F) {
+        return std::nullopt;
+      }
+    } else if (arg == "--threads") {
+      args.thread_count = std::max(1, std::atoi(value));
+    } else if (arg == "--seed") {
+      args.seed = static_cast<uint32_t>(std::strtoul(value, nullptr, 0));
+    } else if (arg == "--lua") {
+      args.lua_script = value;
+    } else if (arg == "--replay") {
+      args.replay = value;
+    } else if (arg == "--lua-calls") {
+      args.lua_call_count = std::max(0, std::atoi(value));
+    } else {
+      return std::nullopt;
+    }
+  }
+  return args;
+}
+
+void print_phase(std::string_view name, std::vector<float> *samples) {
+  const TimingStats stats = compute_timing_stats(samples);
+  std::println(stdout, "{:<10}{:>10.1f}{:>10.1f}{:>10.1f}{:>10.1f}{:>10.1f}",
+               name, stats.mean, stats.p50, stats.p90, stats.p99, stats.max);
+}
+
+// Self checks run by "--check". Each prints what went wrong and returns false
+// on failure.
+
+// Ids taken before "reset()" must not resolve to bodies created after it,
+// also after more resets than there are slot generations.
+bool check_reset_invalidates_ids(SceneSystem *scenes) {
+  constexpr uint32_t RESET_COUNT = BODY_HANDLE_GENERATION_MASK + 2;
+  TwoDimWorldScene scene(scenes);
+  const uint32_t first_id = scene.create_ball();
+  uint32_t prev_id = first_id;
+  for (uint32_t reset = 0; reset < RESET_COUNT; ++reset) {
+    scene.reset();
+    const uint32_t new_id = scene.create_ball();
+    if (new_id == prev_id || new_id == first_id ||
+        scene.has_body(BodyKind::BALL, prev_id) ||
+        scene.has_body(BodyKind::BALL, first_id)) {
+      std::println(stderr, "FAIL: A ball id resolves again after {} resets!",
+                   reset + 1);
+      return false;
+    }
+    prev_id = new_id;
+  }
+  return true;
+}
+
+bool check_vertex_transform() {
+  if (VERTEX_TRANSFORM_SIMD_NAME == nullptr) {
+    return true;
+  }
+  if (!vertex_transform_self_check()) {
+    std::println(stderr, "FAIL: Vertex transform {} path differs from scalar!",
+                 VERTEX_TRANSFORM_SIMD_NAME);
+    return false;
+  }
+  return true;
+}
+
+int run_checks(SceneSystem *scenes) {
+  bool ok = true;
+  ok = check_reset_invalidates_ids(scenes) && ok;
+  ok = check_vertex_transform() && ok;
+  std::println(stdout, "Self checks {}.", ok ? "passed" : "failed");
+  return ok ? 0 : 1;
+}
+
+// How every "lua_interface_*" function used to reach the scene: lock a
+// weak_ptr upvalue into a "new" shared_ptr so it can be deleted before a
+// "lua_error(...)" long jump. Kept here as the baseline for "--lua-calls".
+struct LegacyScenePtr {
+  TwoDimWorldScene *scene_ptr;
+};
+
+int legacy_get_ball_pos(lua_State *lctx) {
+  std::weak_ptr<LegacyScenePtr> *wptr =
+      reinterpret_cast<std::weak_ptr<LegacyScenePtr> *>(
+          lua_touserdata(lctx, lua_upvalueindex(1)));
+  std::shared_ptr<LegacyScenePtr> *sptr =
+      new std::shared_ptr<LegacyScenePtr>(wptr->lock());
+  if (!(*sptr) || lua_gettop(lctx) != 1 || lua_isinteger(lctx, -1) != 1) {
+    delete sptr;
+    lua_pushstring(lctx, "legacy getballpos failed!");
+    return lua_error(lctx);
+  }
+
+  b2Vec2 pos = (*sptr)->scene_ptr->get_ball_pos(lua_tointeger(lctx, -1));
+  lua_pushnumber(lctx, pos.x);
+  lua_pushnumber(lctx, pos.y);
+
+  delete sptr;
+  return 2;
+}
+
+// Runs "count" calls of "func_name" on a ball from a Lua loop, returns ns per
+// call or nullopt on a Lua error.
+std::optional<double> time_lua_calls(lua_State *lua_ctx, const char *table,
+                                     const char *func_name, int count) {
+  const std::string chunk = std::format(
+      "local f, id = {0}.{1}, scene_2d.createball()\n"
+      "for i = 1, {2} do f(id) end\n"
+      "scene_2d.destroyball(id)",
+      table, func_name, count);
+
+  const auto start = std::chrono::steady_clock::now();
+  if (luaL_dostring(lua_ctx, chunk.c_str()) != LUA_OK) {
+    std::println(stderr, "ERROR: {}", lua_tostring(lua_ctx, -1));
+    lua_pop(lua_ctx, 1);
+    return std::nullopt;
+  }
+  const auto end = std::chrono::steady_clock::now();
+
+  return std::chrono::duration<double, std::nano>(end - start).count() / count;
+}
+
+void bench_lua_calls(lua_State *lua_ctx, TwoDimWorldScene *scene, int count) {
+  // The weak_ptr lives in userdata like the old upvalue did, "holder" keeps
+  // it lockable for the duration of the benchmark.
+  auto holder = std::make_shared<LegacyScenePtr>(scene);
+  lua_newtable(lua_ctx);  // +1
+  void *ud = lua_newuserdatauv(lua_ctx, sizeof(std::weak_ptr<LegacyScenePtr>),
+                               0);  // +1
+  std::weak_ptr<LegacyScenePtr> *wptr =
+      new (ud) std::weak_ptr<LegacyScenePtr>(holder);
+  lua_pushcclosure(lua_ctx, legacy_get_ball_pos, 1);  // -1, +1
+  lua_setfield(lua_ctx, -2, "getballpos");            // -1
+  lua_setglobal(lua_ctx, "legacy_scene_2d");          // -1
+
+  const std::optional<double> legacy_ns =
+      time_lua_calls(lua_ctx, "legacy_scene_2d", "getballpos", count);
+  const std::optional<double> handle_ns =
+      time_lua_calls(lua_ctx, "scene_2d", "getballpos", count);
+
+  // The userdata has no "__gc", so destruct the weak_ptr while it is still
+  // referenced and only then let Lua collect it.
+  wptr->~weak_ptr();
+  lua_pushnil(lua_ctx);                       // +1
+  lua_setglobal(lua_ctx, "legacy_scene_2d");  // -1
+
+  if (legacy_ns.has_value() && handle_ns.has_value()) {
+    std::println(stdout,
+                 "scene_2d.getballpos x{}: {:.1f} ns/call (shared_ptr "
+                 "binding {:.1f} ns/call)",
+                 count, handle_ns.value(), legacy_ns.value());
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  std::optional<RunnerArgs> args = parse_args(argc, argv);
+  if (!args.has_value()) {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  // Loads Moonscript and the default script into the shared Lua state.
+  SceneSystem scenes{};
+  scenes.get_sim_settings().physics_thread_count = args->thread_count;
+  lua_State *lua_ctx = reinterpret_cast<lua_State *>(
+      scenes.get_map_value("lua_state").value());
+  if (args->lua_script.has_value() &&
+      luaL_dofile(lua_ctx, args->lua_script->c_str()) != LUA_OK) {
+    std::println(stderr, "ERROR: {}", lua_tostring(lua_ctx, -1));
+    return 1;
+  }
+
+  if (args->check) {
+    return run_checks(&scenes);
+  }
+
+  TwoDimWorldScene scene(&scenes);
+  if (args->seed.has_value()) {
+    scene.set_seed(args->seed.value());
+  }
+  if (args->replay.has_value() && !scene.start_replay(args->replay.value())) {
+    std::println(stderr, "ERROR: Failed to load replay \"{}\"!",
+                 args->replay.value());
+    return 1;
+  }
+
+  // Index 0 is the whole update, the rest match UpdateTimings.
+  std::array<std::vector<float>, 7> samples;
+  for (std::vector<float> &phase : samples) {
+    phase.reserve(static_cast<size_t>(args->frame_count));
+  }
+
+  for (int frame = 0; frame < args->frame_count; ++frame) {
+    const auto start = std::chrono::steady_clock::now();
+    scene.update(&scenes, args->frame_dt);
+    const auto end = std::chrono::steady_clock::now();
+
+    const UpdateTimings &timings = scene.get_update_timings();
+    samples[0].push_back(
+        std::chrono::duration<float, std::micro>(end - start).count());
+    samples[1].push_back(timings.input_us);
+    samples[2].push_back(timings.lua_us);
+    samples[3].push_back(timings.physics_us);
+    samples[4].push_back(timings.world_step_us);
+    samples[5].push_back(timings.events_us);
+    samples[6].push_back(timings.particles_us);
+  }
+
+  std::println(stdout, "{} frames at dt {:.4f}s, {} physics thread(s)",
+               args->frame_count, args->frame_dt,
+               scenes.get_sim_settings().physics_thread_count);
+  std::println(stdout, "{:<10}{:>10}{:>10}{:>10}{:>10}{:>10}", "phase (us)",
+               "mean", "p50", "p90", "p99", "max");
+  print_phase("update", &samples[0]);
+  print_phase("input", &samples[1]);
+  print_phase("lua", &samples[2]);
+  print_phase("physics", &samples[3]);
+  print_phase("b2 step", &samples[4]);
+  print_phase("events", &samples[5]);
+  print_phase("particles", &samples[6]);
+
+  if (args->lua_call_count > 0) {
+    bench_lua_calls(lua_ctx, &scene, args->lua_call_count);
+  }
+
+  return 0;
+}
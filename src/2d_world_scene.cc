@@ -18,1011 +18,1396 @@
 
 // third party includes
 extern "C" {
+#include <lauxlib.h>
 #include <lua.h>
 }
 #include <raylib.h>
 
 // standard library includes
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cmath>
 #include <cstdlib>
+#include <deque>
 #include <format>
+#include <numeric>
 #include <print>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+float elapsed_us(std::chrono::steady_clock::time_point from,
+                 std::chrono::steady_clock::time_point to) {
+  return std::chrono::duration<float, std::micro>(to - from).count();
+}
+
+b2Transform interpolate_transform(const b2Transform &from,
+                                  const b2Transform &to, float alpha) {
+  return b2Transform{b2Lerp(from.p, to.p, alpha), b2NLerp(from.q, to.q, alpha)};
+}
 
 // Lua functions
-int lua_interface_create_ball(lua_State *lctx) {
-  std::weak_ptr<TDWSPtrHolder> *wptr =
-      reinterpret_cast<std::weak_ptr<TDWSPtrHolder> *>(
-          lua_touserdata(lctx, lua_upvalueindex(1)));
 
-  // In this function and following other "lua_interface_*" functions, a ptr is
-  // initialized with "new". This is required because "lua_error(...)" does a
-  // long jump if it is ever called. To prepare for the long jump, the pointer
-  // is destructed with "delete" before calling "lua_error(...)".
-  std::shared_ptr<TDWSPtrHolder> *sptr =
-      new std::shared_ptr<TDWSPtrHolder>(std::move(wptr->lock()));
+// Scene of the closure being called, from the handle in upvalue 1 (see
+// "TwoDimWorldScene::from_lua_handle(...)"). Returns nullptr with an error
+// message pushed if the scene is gone, the caller should then
+// "return lua_error(lctx);". Nothing is allocated per call, so the following
+// "lua_interface_*" functions may "lua_error(...)" (a long jump) at any point
+// as long as no local needs destructing.
+TwoDimWorldScene *lua_interface_helper_get_scene(lua_State *lctx) {
+  TwoDimWorldScene *scene = TwoDimWorldScene::from_lua_handle(
+      lua_tointeger(lctx, lua_upvalueindex(1)));
+
+  if (!scene) {
+    const char *name = lua_tostring(lctx, lua_upvalueindex(2));
+    std::string out =
+        std::format("\"{}\" is only available in 2DSimulation Scene.", name);
+    std::println(stdout, "{}", out);
+    lua_pushstring(lctx, out.c_str());
+  }
+
+  return scene;
+}
 
-  if (!(*sptr)) {
-    delete sptr;
+// Raises "message" prefixed with the function's name.
+int lua_interface_helper_error(lua_State *lctx, const char *message) {
+  {
+    const char *name = lua_tostring(lctx, lua_upvalueindex(2));
+    std::string out = std::format("\"{}\" {}", name, message);
+    std::println(stdout, "{}", out);
+    lua_pushstring(lctx, out.c_str());
+  }
 
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" is only available in 2DSimulation Scene.", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
+  return lua_error(lctx);
+}
 
-    return lua_error(lctx);
+// Full userdata handle of one body, with the methods in LUA_BODY_METHODS. It
+// holds the scene's Lua handle too, so a body of a destroyed scene can't reach
+// a newer scene's body with the same handle.
+struct LuaBody {
+  int64_t scene_handle;
+  uint32_t handle;
+  BodyKind kind;
+};
+
+// Lua: -0, +1
+// Pushes the userdata of body "handle". The same userdata is pushed for as
+// long as the body lives, so its per-body table (see "body:data()") persists.
+void lua_interface_helper_push_body(lua_State *lctx, int64_t scene_handle,
+                                    uint32_t handle, BodyKind kind) {
+  lua_getfield(lctx, LUA_REGISTRYINDEX, LUA_BODY_CACHE);  // +1
+  if (lua_rawgeti(lctx, -1, handle) == LUA_TUSERDATA) {   // +1
+    lua_remove(lctx, -2);                                 // -1
+    return;
   }
-  TwoDimWorldScene *scene = (*sptr)->scene_ptr;
+  lua_pop(lctx, 1);  // -1
 
-  uint32_t id = scene->create_ball();
+  LuaBody *body = reinterpret_cast<LuaBody *>(
+      lua_newuserdatauv(lctx, sizeof(LuaBody), 1));  // +1
+  *body = LuaBody{scene_handle, handle, kind};
+  luaL_setmetatable(lctx, LUA_BODY_METATABLE);
+  lua_pushvalue(lctx, -1);        // +1
+  lua_rawseti(lctx, -3, handle);  // -1
+  lua_remove(lctx, -2);           // -1
+}
 
-  lua_pushinteger(lctx, id);
-  delete sptr;
+// Per-kind Lua functions ("createball", "setoctagonpos", ...) are generated
+// from the shared "TwoDimWorldScene::*_body(BodyKind, ...)" members. Argument
+// checks, usage messages and result pushing are derived from the member's
+// parameter and return types, so a new BodyKind only needs its name in
+// BODY_KIND_NAMES.
+
+// How one member parameter is read from Lua. An argument may take a range of
+// Lua slots, but only the last one may take a variable number.
+template <typename T>
+struct LuaBodyArg;
+
+// Body handles.
+template <>
+struct LuaBodyArg<uint32_t> {
+  static constexpr int MIN_SLOTS = 1;
+  static constexpr int MAX_SLOTS = 1;
+
+  static bool check(lua_State *lctx, int idx) {
+    return lua_isinteger(lctx, idx) == 1;
+  }
+  static uint32_t get(lua_State *lctx, int idx) {
+    return static_cast<uint32_t>(lua_tointeger(lctx, idx));
+  }
+  static std::string describe(BodyKind kind) {
+    return std::format("integer ({} id)",
+                       BODY_KIND_NAMES[static_cast<size_t>(kind)]);
+  }
+};
+
+template <>
+struct LuaBodyArg<float> {
+  static constexpr int MIN_SLOTS = 1;
+  static constexpr int MAX_SLOTS = 1;
+
+  static bool check(lua_State *lctx, int idx) {
+    return lua_isnumber(lctx, idx) == 1;
+  }
+  static float get(lua_State *lctx, int idx) {
+    return static_cast<float>(lua_tonumber(lctx, idx));
+  }
+  static std::string describe(BodyKind) { return "number"; }
+};
+
+// Red, green, blue and optional alpha integers.
+template <>
+struct LuaBodyArg<Color> {
+  static constexpr int MIN_SLOTS = 3;
+  static constexpr int MAX_SLOTS = 4;
+
+  static bool check(lua_State *lctx, int idx) {
+    for (int channel = idx; channel <= lua_gettop(lctx); ++channel) {
+      if (lua_isinteger(lctx, channel) != 1 ||
+          lua_tointeger(lctx, channel) < 0 ||
+          lua_tointeger(lctx, channel) > 255) {
+        return false;
+      }
+    }
+    return true;
+  }
+  static Color get(lua_State *lctx, int idx) {
+    return Color{static_cast<uint8_t>(lua_tointeger(lctx, idx)),
+                 static_cast<uint8_t>(lua_tointeger(lctx, idx + 1)),
+                 static_cast<uint8_t>(lua_tointeger(lctx, idx + 2)),
+                 lua_gettop(lctx) > idx + 2
+                     ? static_cast<uint8_t>(lua_tointeger(lctx, idx + 3))
+                     : static_cast<uint8_t>(255)};
+  }
+  static std::string describe(BodyKind) {
+    return "integer (red 0-255), integer (green 0-255), integer (blue 0-255), "
+           "integer (optional; alpha 0-255)";
+  }
+};
+
+// Pushes a member's return value, returns the count of pushed values.
+int lua_interface_helper_push_result(lua_State *lctx, bool value) {
+  lua_pushboolean(lctx, value ? 1 : 0);
+  return 1;
+}
+
+int lua_interface_helper_push_result(lua_State *lctx, uint32_t value) {
+  lua_pushinteger(lctx, value);
   return 1;
 }
 
-int lua_interface_destroy_ball(lua_State *lctx) {
-  std::weak_ptr<TDWSPtrHolder> *wptr =
-      reinterpret_cast<std::weak_ptr<TDWSPtrHolder> *>(
-          lua_touserdata(lctx, lua_upvalueindex(1)));
+int lua_interface_helper_push_result(lua_State *lctx, b2Vec2 value) {
+  lua_pushnumber(lctx, value.x);
+  lua_pushnumber(lctx, value.y);
+  return 2;
+}
+
+// Only the last argument may take a variable number of slots, the ones after
+// it would have no fixed stack index.
+template <typename... Args>
+constexpr bool lua_body_args_fixed_but_last() {
+  constexpr std::array<bool, sizeof...(Args)> fixed{
+      (LuaBodyArg<Args>::MIN_SLOTS == LuaBodyArg<Args>::MAX_SLOTS)...};
+  for (size_t arg = 0; arg + 1 < sizeof...(Args); ++arg) {
+    if (!fixed[arg]) {
+      return false;
+    }
+  }
+  return true;
+}
 
-  std::shared_ptr<TDWSPtrHolder> *sptr =
-      new std::shared_ptr<TDWSPtrHolder>(std::move(wptr->lock()));
+// Lua stack index of each argument's first slot.
+template <typename... Args>
+constexpr std::array<int, sizeof...(Args)> lua_body_arg_indices() {
+  constexpr std::array<int, sizeof...(Args)> slots{
+      LuaBodyArg<Args>::MIN_SLOTS...};
+  std::array<int, sizeof...(Args)> indices{};
+  int idx = 1;
+  for (size_t arg = 0; arg < sizeof...(Args); ++arg) {
+    indices[arg] = idx;
+    idx += slots[arg];
+  }
+  return indices;
+}
 
-  if (!(*sptr)) {
-    delete sptr;
+template <typename Ret, typename... Args>
+struct LuaBodyBinding {
+  static constexpr int MIN_ARGS = (0 + ... + LuaBodyArg<Args>::MIN_SLOTS);
+  static constexpr int MAX_ARGS = (0 + ... + LuaBodyArg<Args>::MAX_SLOTS);
+  static constexpr std::array<int, sizeof...(Args)> ARG_INDICES =
+      lua_body_arg_indices<Args...>();
+  static_assert(lua_body_args_fixed_but_last<Args...>(),
+                "Only the last argument may take a variable slot count!");
 
+  static int usage_error(lua_State *lctx, BodyKind kind) {
     {
+      std::string args;
+      ((args += (args.empty() ? "" : ", ") + LuaBodyArg<Args>::describe(kind)),
+       ...);
+      std::string count = std::to_string(MIN_ARGS);
+      if constexpr (MIN_ARGS != MAX_ARGS) {
+        count += std::format("-{}", MAX_ARGS);
+      }
       const char *name = lua_tostring(lctx, lua_upvalueindex(2));
       std::string out =
-          std::format("\"{}\" is only available in 2DSimulation Scene.", name);
+          std::format("\"{}\" expects {} {}: {}!", name, count,
+                      MAX_ARGS == 1 ? "argument" : "args", args);
       std::println(stdout, "{}", out);
       lua_pushstring(lctx, out.c_str());
     }
 
     return lua_error(lctx);
   }
-  TwoDimWorldScene *scene = (*sptr)->scene_ptr;
 
-  if (lua_gettop(lctx) != 1 || lua_isinteger(lctx, -1) != 1) {
-    delete sptr;
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" expects 1 argument: integer (ball id).", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
+  template <BodyKind Kind, auto Method>
+  static int call(lua_State *lctx) {
+    TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+    if (!scene) {
+      return lua_error(lctx);
+    }
+
+    // Functions without parameters ignore any arguments.
+    if constexpr (MAX_ARGS > 0) {
+      const int top = lua_gettop(lctx);
+      const bool valid = [&]<size_t... Arg>(std::index_sequence<Arg...>) {
+        return top >= MIN_ARGS && top <= MAX_ARGS &&
+               (LuaBodyArg<Args>::check(lctx, ARG_INDICES[Arg]) && ...);
+      }(std::index_sequence_for<Args...>{});
+      if (!valid) {
+        return usage_error(lctx, Kind);
+      }
     }
 
+    return [&]<size_t... Arg>(std::index_sequence<Arg...>) {
+      if constexpr (std::is_void_v<Ret>) {
+        (scene->*Method)(Kind,
+                         LuaBodyArg<Args>::get(lctx, ARG_INDICES[Arg])...);
+        return 0;
+      } else {
+        return lua_interface_helper_push_result(
+            lctx, (scene->*Method)(
+                      Kind, LuaBodyArg<Args>::get(lctx, ARG_INDICES[Arg])...));
+      }
+    }(std::index_sequence_for<Args...>{});
+  }
+};
+
+// Picks LuaBodyBinding's parameters from a member function pointer type.
+template <typename Method>
+struct LuaBodyMethod;
+
+template <typename Ret, typename... Args>
+struct LuaBodyMethod<Ret (TwoDimWorldScene::*)(BodyKind, Args...)> {
+  using Binding = LuaBodyBinding<Ret, Args...>;
+};
+
+template <typename Ret, typename... Args>
+struct LuaBodyMethod<Ret (TwoDimWorldScene::*)(BodyKind, Args...) const> {
+  using Binding = LuaBodyBinding<Ret, Args...>;
+};
+
+template <BodyKind Kind, auto Method>
+int lua_interface_body(lua_State *lctx) {
+  return LuaBodyMethod<decltype(Method)>::Binding::template call<Kind, Method>(
+      lctx);
+}
+
+// "create{kind}(as_userdata)", returns the body's userdata instead of its id
+// if "as_userdata" is true.
+template <BodyKind Kind>
+int lua_interface_create_body(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
     return lua_error(lctx);
   }
 
-  bool ret = scene->destroy_ball(lua_tointeger(lctx, -1));
+  const uint32_t id = scene->create_body(Kind);
 
-  lua_pushboolean(lctx, ret ? 1 : 0);
-  delete sptr;
+  if (lua_toboolean(lctx, 1) == 0) {
+    lua_pushinteger(lctx, id);
+  } else if (id == BODY_HANDLE_INVALID) {
+    lua_pushnil(lctx);
+  } else {
+    lua_interface_helper_push_body(
+        lctx, lua_tointeger(lctx, lua_upvalueindex(1)), id, Kind);
+  }
   return 1;
 }
 
-int lua_interface_get_ball_pos(lua_State *lctx) {
-  std::weak_ptr<TDWSPtrHolder> *wptr =
-      reinterpret_cast<std::weak_ptr<TDWSPtrHolder> *>(
-          lua_touserdata(lctx, lua_upvalueindex(1)));
+struct LuaBodyFunction {
+  // The Lua name is "{prefix}{kind name}{suffix}".
+  const char *prefix;
+  const char *suffix;
+  // Indexed by BodyKind.
+  std::array<lua_CFunction, BODY_KIND_COUNT> functions;
+};
+
+template <auto Method, size_t... Kind>
+constexpr LuaBodyFunction lua_body_function(const char *prefix,
+                                            const char *suffix,
+                                            std::index_sequence<Kind...>) {
+  return LuaBodyFunction{
+      prefix, suffix,
+      {lua_interface_body<static_cast<BodyKind>(Kind), Method>...}};
+}
 
-  std::shared_ptr<TDWSPtrHolder> *sptr =
-      new std::shared_ptr<TDWSPtrHolder>(std::move(wptr->lock()));
+template <auto Method>
+constexpr LuaBodyFunction lua_body_function(const char *prefix,
+                                            const char *suffix) {
+  return lua_body_function<Method>(prefix, suffix,
+                                   std::make_index_sequence<BODY_KIND_COUNT>{});
+}
 
-  if (!(*sptr)) {
-    delete sptr;
+template <size_t... Kind>
+constexpr LuaBodyFunction lua_create_body_function(
+    std::index_sequence<Kind...>) {
+  return LuaBodyFunction{
+      "create",
+      "",
+      {lua_interface_create_body<static_cast<BodyKind>(Kind)>...}};
+}
 
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" is only available in 2DSimulation Scene.", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
+constexpr std::array LUA_BODY_FUNCTIONS{
+    lua_create_body_function(std::make_index_sequence<BODY_KIND_COUNT>{}),
+    lua_body_function<&TwoDimWorldScene::destroy_body>("destroy", ""),
+    lua_body_function<&TwoDimWorldScene::get_body_pos>("get", "pos"),
+    lua_body_function<&TwoDimWorldScene::queue_body_pos>("set", "pos"),
+    lua_body_function<&TwoDimWorldScene::get_body_vel>("get", "vel"),
+    lua_body_function<&TwoDimWorldScene::queue_body_impulse>("apply",
+                                                             "impulse"),
+    lua_body_function<&TwoDimWorldScene::set_body_color>("set", "color"),
+};
+
+// True if the value at "idx" is a number other than inf or NaN.
+bool lua_interface_helper_is_finite(lua_State *lctx, int idx) {
+  return lua_isnumber(lctx, idx) == 1 && std::isfinite(lua_tonumber(lctx, idx));
+}
+
+// Reads optional number field "key" of the table at "idx". Returns false if
+// the field is set to something other than a finite number.
+bool lua_interface_helper_get_number_field(lua_State *lctx, int idx,
+                                           const char *key,
+                                           std::optional<float> *out) {
+  int type = lua_getfield(lctx, idx, key);  // +1
+  bool ok = true;
+  if (type == LUA_TNUMBER && lua_interface_helper_is_finite(lctx, -1)) {
+    *out = static_cast<float>(lua_tonumber(lctx, -1));
+  } else if (type != LUA_TNIL) {
+    ok = false;
+  }
+  lua_pop(lctx, 1);  // -1
+  return ok;
+}
+
+// Reads optional field "key" of the table at "idx" holding a color table
+// "{r, g, b, a (optional)}" with integers 0-255. Returns false if malformed.
+bool lua_interface_helper_get_color_field(lua_State *lctx, int idx,
+                                          const char *key,
+                                          std::optional<Color> *out) {
+  int type = lua_getfield(lctx, idx, key);  // +1
+  if (type == LUA_TNIL) {
+    lua_pop(lctx, 1);  // -1
+    return true;
+  } else if (type != LUA_TTABLE) {
+    lua_pop(lctx, 1);  // -1
+    return false;
+  }
+
+  uint8_t channels[4] = {255, 255, 255, 255};
+  bool ok = true;
+  for (int channel = 0; channel < 4; ++channel) {
+    type = lua_geti(lctx, -1, channel + 1);  // +1
+    if (lua_isinteger(lctx, -1) == 1 && lua_tointeger(lctx, -1) >= 0 &&
+        lua_tointeger(lctx, -1) <= 255) {
+      channels[channel] = static_cast<uint8_t>(lua_tointeger(lctx, -1));
+    } else if (type != LUA_TNIL || channel < 3) {
+      ok = false;
     }
+    lua_pop(lctx, 1);  // -1
+  }
+  lua_pop(lctx, 1);  // -1
+
+  if (ok) {
+    *out = Color{channels[0], channels[1], channels[2], channels[3]};
+  }
+  return ok;
+}
+
+// Reads the optional table at "idx" into "params" (fields vx, vy, speed,
+// angle, spread, life, color), keeping defaults for missing fields. Returns
+// false if a field is malformed.
+bool lua_interface_helper_get_particle_params(lua_State *lctx, int idx,
+                                              ParticleParams *params) {
+  *params = default_particle_params();
+  if (lua_isnoneornil(lctx, idx) == 1) {
+    return true;
+  } else if (lua_istable(lctx, idx) != 1) {
+    return false;
+  }
+
+  std::optional<float> vx, vy, speed, angle, spread, life;
+  std::optional<Color> color;
+  if (!lua_interface_helper_get_number_field(lctx, idx, "vx", &vx) ||
+      !lua_interface_helper_get_number_field(lctx, idx, "vy", &vy) ||
+      !lua_interface_helper_get_number_field(lctx, idx, "speed", &speed) ||
+      !lua_interface_helper_get_number_field(lctx, idx, "angle", &angle) ||
+      !lua_interface_helper_get_number_field(lctx, idx, "spread", &spread) ||
+      !lua_interface_helper_get_number_field(lctx, idx, "life", &life) ||
+      !lua_interface_helper_get_color_field(lctx, idx, "color", &color)) {
+    return false;
+  }
+
+  params->velocity = b2Vec2{vx.value_or(params->velocity.x),
+                            vy.value_or(params->velocity.y)};
+  params->speed = speed.value_or(params->speed);
+  params->angle = angle.value_or(params->angle);
+  params->spread = spread.value_or(params->spread);
+  params->life = life.value_or(params->life);
+  params->color = color.value_or(params->color);
+  return params->life > 0.0F;
+}
 
+int lua_interface_spawn(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
     return lua_error(lctx);
   }
-  TwoDimWorldScene *scene = (*sptr)->scene_ptr;
 
-  if (lua_gettop(lctx) != 1 || lua_isinteger(lctx, -1) != 1) {
-    delete sptr;
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" expects 1 integer argument ball id!", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
+  const int top = lua_gettop(lctx);
+  if (top < 2 || top > 3 || lua_type(lctx, 1) != LUA_TSTRING ||
+      lua_isinteger(lctx, 2) != 1 || lua_tointeger(lctx, 2) < 0 ||
+      (top == 3 && lua_isnil(lctx, 3) != 1 && lua_istable(lctx, 3) != 1)) {
+    return lua_interface_helper_error(
+        lctx,
+        "expects 2-3 args: string (kind), integer (count), table (optional; x, "
+        "y, vx, vy, dx, dy, color)!");
+  }
+
+  std::optional<BodyKind> kind = body_kind_from_name(lua_tostring(lctx, 1));
+  if (!kind.has_value()) {
+    return lua_interface_helper_error(
+        lctx, "kind must be \"ball\", \"octagon\" or \"trapezoid\"!");
+  }
+
+  SpawnParams params{std::nullopt, std::nullopt, b2Vec2{0.0F, 0.0F},
+                     std::nullopt};
+  if (top == 3 && lua_istable(lctx, 3) == 1) {
+    std::optional<float> x, y, vx, vy, dx, dy;
+    if (!lua_interface_helper_get_number_field(lctx, 3, "x", &x) ||
+        !lua_interface_helper_get_number_field(lctx, 3, "y", &y) ||
+        !lua_interface_helper_get_number_field(lctx, 3, "vx", &vx) ||
+        !lua_interface_helper_get_number_field(lctx, 3, "vy", &vy) ||
+        !lua_interface_helper_get_number_field(lctx, 3, "dx", &dx) ||
+        !lua_interface_helper_get_number_field(lctx, 3, "dy", &dy)) {
+      return lua_interface_helper_error(
+          lctx, "expects x, y, vx, vy, dx, dy to be numbers!");
+    }
+    if (!lua_interface_helper_get_color_field(lctx, 3, "color",
+                                              &params.color)) {
+      return lua_interface_helper_error(
+          lctx,
+          "expects color to be a table of integers {r, g, b, a (optional)} in "
+          "range 0-255!");
+    }
+    if (x.has_value() != y.has_value()) {
+      return lua_interface_helper_error(
+          lctx, "expects x and y to be given together!");
     }
 
-    return lua_error(lctx);
+    if (x.has_value()) {
+      params.position = b2Vec2{x.value(), y.value()};
+    }
+    if (vx.has_value() || vy.has_value()) {
+      params.velocity = b2Vec2{vx.value_or(0.0F), vy.value_or(0.0F)};
+    }
+    params.spacing = b2Vec2{dx.value_or(0.0F), dy.value_or(0.0F)};
   }
 
-  uint32_t idx = lua_tointeger(lctx, -1);
+  // Checked before narrowing, larger counts could never all be created.
+  const lua_Integer count = lua_tointeger(lctx, 2);
+  if (count > static_cast<lua_Integer>(BODY_REGISTRY_CAPACITY -
+                                       scene->get_body_count())) {
+    return lua_interface_helper_error(
+        lctx, "count is more than the bodies that can still be created!");
+  }
 
-  b2Vec2 pos = scene->get_ball_pos(idx);
+  // New bodies are appended to the kind's store, so their handles are read
+  // from there. Nothing C++ owned is alive if building the table long jumps.
+  const size_t first = scene->get_body_store(kind.value()).size();
+  scene->spawn_bodies(kind.value(), static_cast<int>(count), params, nullptr);
+  const BodyRegistry::KindStore &store = scene->get_body_store(kind.value());
 
-  lua_pushnumber(lctx, pos.x);
-  lua_pushnumber(lctx, pos.y);
+  lua_createtable(lctx, static_cast<int>(store.size() - first), 0);  // +1
+  for (size_t idx = first; idx < store.size(); ++idx) {
+    lua_pushinteger(lctx, store.handles[idx]);                        // +1
+    lua_rawseti(lctx, -2, static_cast<lua_Integer>(idx - first + 1));  // -1
+  }
 
-  delete sptr;
-  return 2;
+  return 1;
 }
 
-int lua_interface_set_ball_pos(lua_State *lctx) {
-  std::weak_ptr<TDWSPtrHolder> *wptr =
-      reinterpret_cast<std::weak_ptr<TDWSPtrHolder> *>(
-          lua_touserdata(lctx, lua_upvalueindex(1)));
+int lua_interface_set_camera(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
+    return lua_error(lctx);
+  }
 
-  std::shared_ptr<TDWSPtrHolder> *sptr =
-      new std::shared_ptr<TDWSPtrHolder>(std::move(wptr->lock()));
+  if (lua_gettop(lctx) < 2 || lua_gettop(lctx) > 3 ||
+      lua_isnumber(lctx, 1) != 1 || lua_isnumber(lctx, 2) != 1 ||
+      (lua_gettop(lctx) == 3 &&
+       (lua_isnumber(lctx, 3) != 1 || lua_tonumber(lctx, 3) <= 0.0))) {
+    return lua_interface_helper_error(
+        lctx,
+        "expects 2-3 args: number (left x), number (top y), number (optional; "
+        "zoom > 0)!");
+  }
 
-  if (!(*sptr)) {
-    delete sptr;
+  scene->set_camera(
+      static_cast<float>(lua_tonumber(lctx, 1)),
+      static_cast<float>(lua_tonumber(lctx, 2)),
+      lua_gettop(lctx) == 3 ? static_cast<float>(lua_tonumber(lctx, 3)) : 1.0F);
 
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" is only available in 2DSimulation Scene.", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
+  return 0;
+}
 
+int lua_interface_create_sensor(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
     return lua_error(lctx);
   }
-  TwoDimWorldScene *scene = (*sptr)->scene_ptr;
 
-  if (lua_gettop(lctx) != 3 || lua_isinteger(lctx, -3) != 1 ||
-      lua_isnumber(lctx, -2) != 1 || lua_isnumber(lctx, -1) != 1) {
-    delete sptr;
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out = std::format(
-          "\"{}\" expects 3 args: integer (ball id), number (x pos), number (y "
-          "pos)!",
-          name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
+  if (lua_gettop(lctx) != 4 || !lua_interface_helper_is_finite(lctx, 1) ||
+      !lua_interface_helper_is_finite(lctx, 2) ||
+      !lua_interface_helper_is_finite(lctx, 3) ||
+      !lua_interface_helper_is_finite(lctx, 4) ||
+      lua_tonumber(lctx, 3) <= 0.0 || lua_tonumber(lctx, 4) <= 0.0) {
+    return lua_interface_helper_error(
+        lctx,
+        "expects 4 finite args: number (center x), number (center y), number "
+        "(half width > 0), number (half height > 0)!");
+  }
+
+  uint32_t id = scene->create_sensor(static_cast<float>(lua_tonumber(lctx, 1)),
+                                     static_cast<float>(lua_tonumber(lctx, 2)),
+                                     static_cast<float>(lua_tonumber(lctx, 3)),
+                                     static_cast<float>(lua_tonumber(lctx, 4)));
+
+  lua_pushinteger(lctx, id);
+  return 1;
+}
 
+int lua_interface_destroy_sensor(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
     return lua_error(lctx);
   }
 
-  scene->set_ball_pos(lua_tointeger(lctx, -3), lua_tonumber(lctx, -2),
-                      lua_tonumber(lctx, -1));
+  if (lua_gettop(lctx) != 1 || lua_isinteger(lctx, 1) != 1) {
+    return lua_interface_helper_error(
+        lctx, "expects 1 argument: integer (sensor id).");
+  }
 
-  delete sptr;
-  return 0;
+  bool ret = scene->destroy_sensor(lua_tointeger(lctx, 1));
+
+  lua_pushboolean(lctx, ret ? 1 : 0);
+  return 1;
 }
 
-int lua_interface_get_ball_vel(lua_State *lctx) {
-  std::weak_ptr<TDWSPtrHolder> *wptr =
-      reinterpret_cast<std::weak_ptr<TDWSPtrHolder> *>(
-          lua_touserdata(lctx, lua_upvalueindex(1)));
+// Lua: -0, +1
+// Pushes the table at "idx" if it is a table. Otherwise pushes
+// "scene_2d.<field>", creating it if needed.
+void lua_interface_helper_push_result_table(lua_State *lctx, int idx,
+                                            const char *field) {
+  if (lua_istable(lctx, idx) == 1) {
+    lua_pushvalue(lctx, idx);  // +1
+    return;
+  }
 
-  std::shared_ptr<TDWSPtrHolder> *sptr =
-      new std::shared_ptr<TDWSPtrHolder>(std::move(wptr->lock()));
+  lua_getglobal(lctx, "scene_2d");                    // +1
+  if (lua_getfield(lctx, -1, field) != LUA_TTABLE) {  // +1
+    lua_pop(lctx, 1);                                 // -1
+    lua_newtable(lctx);                               // +1
+    lua_pushvalue(lctx, -1);                          // +1
+    lua_setfield(lctx, -3, field);                    // -1
+  }
+  lua_remove(lctx, -2);  // -1
+}
 
-  if (!(*sptr)) {
-    delete sptr;
+// Lua: -0, +0
+// Writes "ids" to the table at "idx" as an array with its length in field
+// "n". Entries left over from a longer previous result are cleared.
+void lua_interface_helper_write_query_results(
+    lua_State *lctx, int idx, const std::vector<uint32_t> &ids) {
+  idx = lua_absindex(lctx, idx);
 
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" is only available in 2DSimulation Scene.", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
+  lua_Integer prev_n = 0;
+  if (lua_getfield(lctx, idx, "n") == LUA_TNUMBER) {  // +1
+    prev_n = lua_tointeger(lctx, -1);
+  }
+  lua_pop(lctx, 1);  // -1
 
-    return lua_error(lctx);
+  for (size_t i = 0; i < ids.size(); ++i) {
+    lua_pushinteger(lctx, ids[i]);                            // +1
+    lua_rawseti(lctx, idx, static_cast<lua_Integer>(i + 1));  // -1
+  }
+  for (lua_Integer i = static_cast<lua_Integer>(ids.size()) + 1; i <= prev_n;
+       ++i) {
+    lua_pushnil(lctx);          // +1
+    lua_rawseti(lctx, idx, i);  // -1
   }
-  TwoDimWorldScene *scene = (*sptr)->scene_ptr;
 
-  if (lua_gettop(lctx) != 1 || lua_isinteger(lctx, -1) != 1) {
-    delete sptr;
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" expects 1 integer argument ball id!", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
+  lua_pushinteger(lctx, static_cast<lua_Integer>(ids.size()));  // +1
+  lua_setfield(lctx, idx, "n");                                 // -1
+}
 
+// Shared by the query functions, "arg_count" finite numbers are expected
+// followed by an optional result table. "args_valid", if not null, checks
+// the numbers further.
+int lua_interface_helper_query(
+    lua_State *lctx, int arg_count, const char *usage,
+    bool (*args_valid)(lua_State *),
+    const std::vector<uint32_t> &(*query)(TwoDimWorldScene *, lua_State *)) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
     return lua_error(lctx);
   }
 
-  uint32_t idx = lua_tointeger(lctx, -1);
+  const int top = lua_gettop(lctx);
+  bool args_ok = top == arg_count || (top == arg_count + 1 &&
+                                      (lua_istable(lctx, top) == 1 ||
+                                       lua_isnil(lctx, top) == 1));
+  for (int idx = 1; args_ok && idx <= arg_count; ++idx) {
+    args_ok = lua_interface_helper_is_finite(lctx, idx);
+  }
+  if (!args_ok || (args_valid && !args_valid(lctx))) {
+    return lua_interface_helper_error(lctx, usage);
+  }
 
-  b2Vec2 vel = scene->get_ball_vel(idx);
+  const std::vector<uint32_t> &ids = query(scene, lctx);
 
-  lua_pushnumber(lctx, vel.x);
-  lua_pushnumber(lctx, vel.y);
+  lua_interface_helper_push_result_table(lctx, arg_count + 1,
+                                         "query_result");  // +1
+  lua_interface_helper_write_query_results(lctx, -1, ids);
+  lua_pushinteger(lctx, static_cast<lua_Integer>(ids.size()));  // +1
 
-  delete sptr;
   return 2;
 }
 
-int lua_interface_apply_ball_impulse(lua_State *lctx) {
-  std::weak_ptr<TDWSPtrHolder> *wptr =
-      reinterpret_cast<std::weak_ptr<TDWSPtrHolder> *>(
-          lua_touserdata(lctx, lua_upvalueindex(1)));
-
-  std::shared_ptr<TDWSPtrHolder> *sptr =
-      new std::shared_ptr<TDWSPtrHolder>(std::move(wptr->lock()));
+int lua_interface_query_aabb(lua_State *lctx) {
+  return lua_interface_helper_query(
+      lctx, 4,
+      "expects 4-5 args: number (min x), number (min y), number (max x), "
+      "number (max y), table (optional; result) with min <= max!",
+      [](lua_State *lctx) {
+        return lua_tonumber(lctx, 1) <= lua_tonumber(lctx, 3) &&
+               lua_tonumber(lctx, 2) <= lua_tonumber(lctx, 4);
+      },
+      [](TwoDimWorldScene *scene,
+         lua_State *lctx) -> const std::vector<uint32_t> & {
+        return scene->query_aabb(
+            b2AABB{b2Vec2{static_cast<float>(lua_tonumber(lctx, 1)),
+                          static_cast<float>(lua_tonumber(lctx, 2))},
+                   b2Vec2{static_cast<float>(lua_tonumber(lctx, 3)),
+                          static_cast<float>(lua_tonumber(lctx, 4))}});
+      });
+}
 
-  if (!(*sptr)) {
-    delete sptr;
+int lua_interface_query_circle(lua_State *lctx) {
+  return lua_interface_helper_query(
+      lctx, 3,
+      "expects 3-4 args: number (center x), number (center y), number "
+      "(radius > 0), table (optional; result)!",
+      [](lua_State *lctx) { return lua_tonumber(lctx, 3) > 0.0; },
+      [](TwoDimWorldScene *scene,
+         lua_State *lctx) -> const std::vector<uint32_t> & {
+        return scene->query_circle(
+            b2Vec2{static_cast<float>(lua_tonumber(lctx, 1)),
+                   static_cast<float>(lua_tonumber(lctx, 2))},
+            static_cast<float>(lua_tonumber(lctx, 3)));
+      });
+}
 
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" is only available in 2DSimulation Scene.", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
+int lua_interface_raycast(lua_State *lctx) {
+  return lua_interface_helper_query(
+      lctx, 4,
+      "expects 4-5 args: number (start x), number (start y), number (end x), "
+      "number (end y), table (optional; result)!",
+      nullptr,
+      [](TwoDimWorldScene *scene,
+         lua_State *lctx) -> const std::vector<uint32_t> & {
+        const b2Vec2 start{static_cast<float>(lua_tonumber(lctx, 1)),
+                           static_cast<float>(lua_tonumber(lctx, 2))};
+        const b2Vec2 end{static_cast<float>(lua_tonumber(lctx, 3)),
+                         static_cast<float>(lua_tonumber(lctx, 4))};
+        return scene->cast_ray(start, b2Sub(end, start));
+      });
+}
 
+// Shared by "getpositions" and "getvelocities". Fills the result table with
+// "id, x, y" of every body of a kind as one flat array, read from the cached
+// store so there is no per-body lookup or Box2D call.
+int lua_interface_helper_get_body_states(lua_State *lctx,
+                                         const char *result_field,
+                                         bool velocities) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
     return lua_error(lctx);
   }
-  TwoDimWorldScene *scene = (*sptr)->scene_ptr;
 
-  if (lua_gettop(lctx) != 3 || lua_isinteger(lctx, -3) != 1 ||
-      lua_isnumber(lctx, -2) != 1 || lua_isnumber(lctx, -1) != 1) {
-    delete sptr;
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out = std::format(
-          "\"{}\" expects 3 args: integer (ball id), number (x), number (y)!",
-          name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
+  const int top = lua_gettop(lctx);
+  if ((top != 1 && top != 2) || lua_type(lctx, 1) != LUA_TSTRING ||
+      (top == 2 && lua_istable(lctx, 2) != 1 && lua_isnil(lctx, 2) != 1)) {
+    return lua_interface_helper_error(
+        lctx, "expects 1-2 args: string (kind), table (optional; result)!");
+  }
 
-    return lua_error(lctx);
+  std::optional<BodyKind> kind = body_kind_from_name(lua_tostring(lctx, 1));
+  if (!kind.has_value()) {
+    return lua_interface_helper_error(
+        lctx, "kind must be \"ball\", \"octagon\" or \"trapezoid\"!");
   }
 
-  scene->apply_ball_impulse(lua_tointeger(lctx, -3), lua_tonumber(lctx, -2),
-                            lua_tonumber(lctx, -1));
+  lua_interface_helper_push_result_table(lctx, 2, result_field);  // +1
+  const int idx = lua_gettop(lctx);
 
-  delete sptr;
-  return 0;
-}
+  lua_Integer prev_n = 0;
+  if (lua_getfield(lctx, idx, "n") == LUA_TNUMBER) {  // +1
+    prev_n = lua_tointeger(lctx, -1);
+  }
+  lua_pop(lctx, 1);  // -1
 
-int lua_interface_set_ball_color(lua_State *lctx) {
-  std::weak_ptr<TDWSPtrHolder> *wptr =
-      reinterpret_cast<std::weak_ptr<TDWSPtrHolder> *>(
-          lua_touserdata(lctx, lua_upvalueindex(1)));
+  const BodyRegistry::KindStore &store = scene->get_body_store(kind.value());
+  const lua_Integer count = static_cast<lua_Integer>(store.size());
+  for (size_t i = 0; i < store.size(); ++i) {
+    const b2Vec2 value =
+        velocities ? store.velocities[i] : store.transforms[i].p;
+    const lua_Integer base = static_cast<lua_Integer>(i) * 3;
+    lua_pushinteger(lctx, store.handles[i]);  // +1
+    lua_rawseti(lctx, idx, base + 1);         // -1
+    lua_pushnumber(lctx, value.x);            // +1
+    lua_rawseti(lctx, idx, base + 2);         // -1
+    lua_pushnumber(lctx, value.y);            // +1
+    lua_rawseti(lctx, idx, base + 3);         // -1
+  }
+  for (lua_Integer i = count * 3 + 1; i <= prev_n * 3; ++i) {
+    lua_pushnil(lctx);          // +1
+    lua_rawseti(lctx, idx, i);  // -1
+  }
 
-  std::shared_ptr<TDWSPtrHolder> *sptr =
-      new std::shared_ptr<TDWSPtrHolder>(std::move(wptr->lock()));
+  lua_pushinteger(lctx, count);  // +1
+  lua_setfield(lctx, idx, "n");  // -1
+  lua_pushinteger(lctx, count);  // +1
 
-  if (!(*sptr)) {
-    delete sptr;
+  return 2;
+}
 
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" is only available in 2DSimulation Scene.", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
+int lua_interface_get_positions(lua_State *lctx) {
+  return lua_interface_helper_get_body_states(lctx, "positions_result",
+                                              false);
+}
+
+int lua_interface_get_velocities(lua_State *lctx) {
+  return lua_interface_helper_get_body_states(lctx, "velocities_result",
+                                              true);
+}
+
+// Body userdata methods. Upvalue 1 is unused, the scene comes from "self".
+
+// "self" of a body method and its scene. Returns nullptr with an error message
+// pushed if "self" isn't a body or its scene is gone, the caller should then
+// "return lua_error(lctx);".
+LuaBody *lua_interface_helper_get_body(lua_State *lctx,
+                                       TwoDimWorldScene **scene) {
+  LuaBody *body =
+      reinterpret_cast<LuaBody *>(luaL_testudata(lctx, 1, LUA_BODY_METATABLE));
+  *scene = body ? TwoDimWorldScene::from_lua_handle(body->scene_handle)
+                : nullptr;
+
+  if (!*scene) {
+    const char *name = lua_tostring(lctx, lua_upvalueindex(2));
+    std::string out = std::format(
+        "\"{}\" must be called as a method of a body from the current "
+        "2DSimulation Scene.",
+        name);
+    std::println(stdout, "{}", out);
+    lua_pushstring(lctx, out.c_str());
+    return nullptr;
+  }
+
+  return body;
+}
 
+int lua_interface_body_id(lua_State *lctx) {
+  TwoDimWorldScene *scene;
+  LuaBody *body = lua_interface_helper_get_body(lctx, &scene);
+  if (!body) {
     return lua_error(lctx);
   }
-  TwoDimWorldScene *scene = (*sptr)->scene_ptr;
 
-  if (lua_gettop(lctx) < 4 || lua_gettop(lctx) > 5 ||
-      (lua_gettop(lctx) == 4 &&
-       (lua_isinteger(lctx, -4) != 1 || lua_isinteger(lctx, -3) != 1 ||
-        lua_isinteger(lctx, -2) != 1 || lua_isinteger(lctx, -1) != 1 ||
-        lua_tointeger(lctx, -3) < 0 || lua_tointeger(lctx, -3) > 255 ||
-        lua_tointeger(lctx, -2) < 0 || lua_tointeger(lctx, -2) > 255 ||
-        lua_tointeger(lctx, -1) < 0 || lua_tointeger(lctx, -1) > 255)) ||
-      (lua_gettop(lctx) == 5 &&
-       (lua_isinteger(lctx, -5) != 1 || lua_isinteger(lctx, -4) != 1 ||
-        lua_isinteger(lctx, -3) != 1 || lua_isinteger(lctx, -2) != 1 ||
-        lua_isinteger(lctx, -1) != 1 || lua_tointeger(lctx, -4) < 0 ||
-        lua_tointeger(lctx, -4) > 255 || lua_tointeger(lctx, -3) < 0 ||
-        lua_tointeger(lctx, -3) > 255 || lua_tointeger(lctx, -2) < 0 ||
-        lua_tointeger(lctx, -2) > 255 || lua_tointeger(lctx, -1) < 0 ||
-        lua_tointeger(lctx, -1) > 255))) {
-    delete sptr;
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out = std::format(
-          "\"{}\" expects 4-5 args: integer (ball id), integer (red 0-255), "
-          "integer (green 0-255), integer (blue 0-255), integer (optional; "
-          "alpha 0-255)!",
-          name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
+  lua_pushinteger(lctx, body->handle);
+  return 1;
+}
 
+int lua_interface_body_kind(lua_State *lctx) {
+  TwoDimWorldScene *scene;
+  LuaBody *body = lua_interface_helper_get_body(lctx, &scene);
+  if (!body) {
     return lua_error(lctx);
   }
 
-  if (lua_gettop(lctx) == 4) {
-    scene->set_ball_color(
-        lua_tointeger(lctx, -4),
-        Color{static_cast<uint8_t>(lua_tointeger(lctx, -3)),
-              static_cast<uint8_t>(lua_tointeger(lctx, -2)),
-              static_cast<uint8_t>(lua_tointeger(lctx, -1)), 255});
-  } else if (lua_gettop(lctx) == 5) {
-    scene->set_ball_color(lua_tointeger(lctx, -5),
-                          Color{static_cast<uint8_t>(lua_tointeger(lctx, -4)),
-                                static_cast<uint8_t>(lua_tointeger(lctx, -3)),
-                                static_cast<uint8_t>(lua_tointeger(lctx, -2)),
-                                static_cast<uint8_t>(lua_tointeger(lctx, -1))});
+  lua_pushstring(lctx, BODY_KIND_NAMES[static_cast<size_t>(body->kind)]);
+  return 1;
+}
+
+int lua_interface_body_valid(lua_State *lctx) {
+  TwoDimWorldScene *scene;
+  LuaBody *body = lua_interface_helper_get_body(lctx, &scene);
+  if (!body) {
+    return lua_error(lctx);
   }
 
-  delete sptr;
-  return 0;
+  lua_pushboolean(lctx, scene->has_body(body->kind, body->handle) ? 1 : 0);
+  return 1;
 }
 
-int lua_interface_create_octagon(lua_State *lctx) {
-  std::weak_ptr<TDWSPtrHolder> *wptr =
-      reinterpret_cast<std::weak_ptr<TDWSPtrHolder> *>(
-          lua_touserdata(lctx, lua_upvalueindex(1)));
+int lua_interface_body_pos(lua_State *lctx) {
+  TwoDimWorldScene *scene;
+  LuaBody *body = lua_interface_helper_get_body(lctx, &scene);
+  if (!body) {
+    return lua_error(lctx);
+  }
 
-  std::shared_ptr<TDWSPtrHolder> *sptr =
-      new std::shared_ptr<TDWSPtrHolder>(std::move(wptr->lock()));
+  return lua_interface_helper_push_result(
+      lctx, scene->get_body_pos(body->kind, body->handle));
+}
 
-  if (!(*sptr)) {
-    delete sptr;
+int lua_interface_body_vel(lua_State *lctx) {
+  TwoDimWorldScene *scene;
+  LuaBody *body = lua_interface_helper_get_body(lctx, &scene);
+  if (!body) {
+    return lua_error(lctx);
+  }
 
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" is only available in 2DSimulation Scene.", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
+  return lua_interface_helper_push_result(
+      lctx, scene->get_body_vel(body->kind, body->handle));
+}
 
+int lua_interface_body_set_pos(lua_State *lctx) {
+  TwoDimWorldScene *scene;
+  LuaBody *body = lua_interface_helper_get_body(lctx, &scene);
+  if (!body) {
     return lua_error(lctx);
   }
-  TwoDimWorldScene *scene = (*sptr)->scene_ptr;
 
-  uint32_t id = scene->create_octagon();
+  if (lua_gettop(lctx) != 3 || !lua_interface_helper_is_finite(lctx, 2) ||
+      !lua_interface_helper_is_finite(lctx, 3)) {
+    return lua_interface_helper_error(
+        lctx, "expects 2 finite args: number (x pos), number (y pos)!");
+  }
 
-  lua_pushinteger(lctx, id);
-  delete sptr;
-  return 1;
+  scene->queue_body_pos(body->kind, body->handle, lua_tonumber(lctx, 2),
+                        lua_tonumber(lctx, 3));
+  return 0;
 }
 
-int lua_interface_destroy_octagon(lua_State *lctx) {
-  std::weak_ptr<TDWSPtrHolder> *wptr =
-      reinterpret_cast<std::weak_ptr<TDWSPtrHolder> *>(
-          lua_touserdata(lctx, lua_upvalueindex(1)));
-
-  std::shared_ptr<TDWSPtrHolder> *sptr =
-      new std::shared_ptr<TDWSPtrHolder>(std::move(wptr->lock()));
+int lua_interface_body_impulse(lua_State *lctx) {
+  TwoDimWorldScene *scene;
+  LuaBody *body = lua_interface_helper_get_body(lctx, &scene);
+  if (!body) {
+    return lua_error(lctx);
+  }
 
-  if (!(*sptr)) {
-    delete sptr;
+  if (lua_gettop(lctx) != 3 || !lua_interface_helper_is_finite(lctx, 2) ||
+      !lua_interface_helper_is_finite(lctx, 3)) {
+    return lua_interface_helper_error(
+        lctx, "expects 2 finite args: number (x), number (y)!");
+  }
 
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" is only available in 2DSimulation Scene.", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
+  scene->queue_body_impulse(body->kind, body->handle, lua_tonumber(lctx, 2),
+                            lua_tonumber(lctx, 3));
+  return 0;
+}
 
+int lua_interface_body_color(lua_State *lctx) {
+  TwoDimWorldScene *scene;
+  LuaBody *body = lua_interface_helper_get_body(lctx, &scene);
+  if (!body) {
     return lua_error(lctx);
   }
-  TwoDimWorldScene *scene = (*sptr)->scene_ptr;
 
-  if (lua_gettop(lctx) != 1 || lua_isinteger(lctx, -1) != 1) {
-    delete sptr;
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" expects 1 argument: integer (octagon id).", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
+  if (lua_gettop(lctx) < 4 || lua_gettop(lctx) > 5 ||
+      !LuaBodyArg<Color>::check(lctx, 2)) {
+    return lua_interface_helper_error(
+        lctx,
+        "expects 3-4 args: integer (red 0-255), integer (green 0-255), "
+        "integer (blue 0-255), integer (optional; alpha 0-255)!");
+  }
+
+  scene->set_body_color(body->kind, body->handle,
+                        LuaBodyArg<Color>::get(lctx, 2));
+  return 0;
+}
 
+int lua_interface_body_destroy(lua_State *lctx) {
+  TwoDimWorldScene *scene;
+  LuaBody *body = lua_interface_helper_get_body(lctx, &scene);
+  if (!body) {
     return lua_error(lctx);
   }
 
-  bool ret = scene->destroy_octagon(lua_tointeger(lctx, -1));
+  bool ret = scene->destroy_body(body->kind, body->handle);
 
   lua_pushboolean(lctx, ret ? 1 : 0);
-  delete sptr;
   return 1;
 }
 
-int lua_interface_get_octagon_pos(lua_State *lctx) {
-  std::weak_ptr<TDWSPtrHolder> *wptr =
-      reinterpret_cast<std::weak_ptr<TDWSPtrHolder> *>(
-          lua_touserdata(lctx, lua_upvalueindex(1)));
+// The body's own table for script state, created on first use.
+int lua_interface_body_data(lua_State *lctx) {
+  TwoDimWorldScene *scene;
+  LuaBody *body = lua_interface_helper_get_body(lctx, &scene);
+  if (!body) {
+    return lua_error(lctx);
+  }
 
-  std::shared_ptr<TDWSPtrHolder> *sptr =
-      new std::shared_ptr<TDWSPtrHolder>(std::move(wptr->lock()));
+  if (lua_getiuservalue(lctx, 1, 1) != LUA_TTABLE) {  // +1
+    lua_pop(lctx, 1);                                 // -1
+    lua_newtable(lctx);                               // +1
+    lua_pushvalue(lctx, -1);                          // +1
+    lua_setiuservalue(lctx, 1, 1);                    // -1
+  }
+  return 1;
+}
 
-  if (!(*sptr)) {
-    delete sptr;
+// Body userdata for an existing body id, nil if the id isn't a live body.
+int lua_interface_get_body(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
+    return lua_error(lctx);
+  }
 
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" is only available in 2DSimulation Scene.", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
+  if (lua_gettop(lctx) != 1 || lua_isinteger(lctx, 1) != 1) {
+    return lua_interface_helper_error(
+        lctx, "expects 1 argument: integer (body id).");
+  }
 
-    return lua_error(lctx);
+  const uint32_t id = static_cast<uint32_t>(lua_tointeger(lctx, 1));
+  std::optional<BodyKind> kind = scene->get_body_kind(id);
+  if (!kind.has_value()) {
+    lua_pushnil(lctx);
+  } else {
+    lua_interface_helper_push_body(
+        lctx, lua_tointeger(lctx, lua_upvalueindex(1)), id, kind.value());
   }
-  TwoDimWorldScene *scene = (*sptr)->scene_ptr;
+  return 1;
+}
 
-  if (lua_gettop(lctx) != 1 || lua_isinteger(lctx, -1) != 1) {
-    delete sptr;
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" expects 1 integer argument octagon id!", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
+constexpr std::array<std::pair<const char *, lua_CFunction>, 10>
+    LUA_BODY_METHODS{{{"id", lua_interface_body_id},
+                      {"kind", lua_interface_body_kind},
+                      {"valid", lua_interface_body_valid},
+                      {"pos", lua_interface_body_pos},
+                      {"vel", lua_interface_body_vel},
+                      {"setpos", lua_interface_body_set_pos},
+                      {"impulse", lua_interface_body_impulse},
+                      {"color", lua_interface_body_color},
+                      {"destroy", lua_interface_body_destroy},
+                      {"data", lua_interface_body_data}}};
+
+// Shared by functions taking a file name, returns false if the argument isn't
+// a valid name. "path" becomes "<dir>/<name><extension>".
+bool lua_interface_helper_file_path(lua_State *lctx, const char *dir,
+                                    const char *extension, std::string *path) {
+  if (lua_gettop(lctx) != 1 || lua_type(lctx, 1) != LUA_TSTRING) {
+    return false;
+  }
+  std::string_view name = lua_tostring(lctx, 1);
+  if (name.empty() || name.size() > 64) {
+    return false;
+  }
+  for (char c : name) {
+    if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '-') {
+      return false;
     }
+  }
+  *path = std::format("{}{}/{}{}", FS_ROOT, dir, name, extension);
+  return true;
+}
 
+int lua_interface_save_snapshot(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
     return lua_error(lctx);
   }
 
-  uint32_t idx = lua_tointeger(lctx, -1);
+  // "path" must be destructed before a possible "lua_error(...)".
+  std::optional<bool> ret;
+  {
+    std::string path;
+    if (lua_interface_helper_file_path(lctx, SNAPSHOT_DIR, ".snap", &path)) {
+      ret = scene->save_snapshot_file(path);
+    }
+  }
+  if (!ret.has_value()) {
+    return lua_interface_helper_error(
+        lctx,
+        "expects 1 argument: string (name; up to 64 letters, digits, \"_\" or "
+        "\"-\")!");
+  }
 
-  b2Vec2 pos = scene->get_octagon_pos(idx);
-
-  lua_pushnumber(lctx, pos.x);
-  lua_pushnumber(lctx, pos.y);
-
-  delete sptr;
-  return 2;
+  lua_pushboolean(lctx, ret.value() ? 1 : 0);
+  return 1;
 }
 
-int lua_interface_set_octagon_pos(lua_State *lctx) {
-  std::weak_ptr<TDWSPtrHolder> *wptr =
-      reinterpret_cast<std::weak_ptr<TDWSPtrHolder> *>(
-          lua_touserdata(lctx, lua_upvalueindex(1)));
-
-  std::shared_ptr<TDWSPtrHolder> *sptr =
-      new std::shared_ptr<TDWSPtrHolder>(std::move(wptr->lock()));
-
-  if (!(*sptr)) {
-    delete sptr;
-
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" is only available in 2DSimulation Scene.", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
-
+int lua_interface_load_snapshot(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
     return lua_error(lctx);
   }
-  TwoDimWorldScene *scene = (*sptr)->scene_ptr;
 
-  if (lua_gettop(lctx) != 3 || lua_isinteger(lctx, -3) != 1 ||
-      lua_isnumber(lctx, -2) != 1 || lua_isnumber(lctx, -1) != 1) {
-    delete sptr;
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out = std::format(
-          "\"{}\" expects 3 args: integer (octagon id), number (x pos), number "
-          "(y "
-          "pos)!",
-          name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
+  // "path" must be destructed before a possible "lua_error(...)".
+  std::optional<bool> ret;
+  {
+    std::string path;
+    if (lua_interface_helper_file_path(lctx, SNAPSHOT_DIR, ".snap", &path)) {
+      ret = scene->load_snapshot_file(path);
     }
-
-    return lua_error(lctx);
+  }
+  if (!ret.has_value()) {
+    return lua_interface_helper_error(
+        lctx,
+        "expects 1 argument: string (name; up to 64 letters, digits, \"_\" or "
+        "\"-\")!");
   }
 
-  scene->set_octagon_pos(lua_tointeger(lctx, -3), lua_tonumber(lctx, -2),
-                         lua_tonumber(lctx, -1));
-
-  delete sptr;
-  return 0;
+  lua_pushboolean(lctx, ret.value() ? 1 : 0);
+  return 1;
 }
 
-int lua_interface_get_octagon_vel(lua_State *lctx) {
-  std::weak_ptr<TDWSPtrHolder> *wptr =
-      reinterpret_cast<std::weak_ptr<TDWSPtrHolder> *>(
-          lua_touserdata(lctx, lua_upvalueindex(1)));
-
-  std::shared_ptr<TDWSPtrHolder> *sptr =
-      new std::shared_ptr<TDWSPtrHolder>(std::move(wptr->lock()));
-
-  if (!(*sptr)) {
-    delete sptr;
-
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" is only available in 2DSimulation Scene.", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
-
+int lua_interface_set_seed(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
     return lua_error(lctx);
   }
-  TwoDimWorldScene *scene = (*sptr)->scene_ptr;
-
-  if (lua_gettop(lctx) != 1 || lua_isinteger(lctx, -1) != 1) {
-    delete sptr;
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" expects 1 integer argument octagon id!", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
 
-    return lua_error(lctx);
+  if (lua_gettop(lctx) != 1 || lua_isinteger(lctx, 1) != 1) {
+    return lua_interface_helper_error(
+        lctx, "expects 1 argument: integer (seed).");
   }
 
-  uint32_t idx = lua_tointeger(lctx, -1);
-
-  b2Vec2 vel = scene->get_octagon_vel(idx);
-
-  lua_pushnumber(lctx, vel.x);
-  lua_pushnumber(lctx, vel.y);
+  scene->set_seed(static_cast<uint32_t>(lua_tointeger(lctx, 1)));
 
-  delete sptr;
-  return 2;
+  return 0;
 }
 
-int lua_interface_apply_octagon_impulse(lua_State *lctx) {
-  std::weak_ptr<TDWSPtrHolder> *wptr =
-      reinterpret_cast<std::weak_ptr<TDWSPtrHolder> *>(
-          lua_touserdata(lctx, lua_upvalueindex(1)));
-
-  std::shared_ptr<TDWSPtrHolder> *sptr =
-      new std::shared_ptr<TDWSPtrHolder>(std::move(wptr->lock()));
-
-  if (!(*sptr)) {
-    delete sptr;
-
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" is only available in 2DSimulation Scene.", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
-
+int lua_interface_start_recording(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
     return lua_error(lctx);
   }
-  TwoDimWorldScene *scene = (*sptr)->scene_ptr;
 
-  if (lua_gettop(lctx) != 3 || lua_isinteger(lctx, -3) != 1 ||
-      lua_isnumber(lctx, -2) != 1 || lua_isnumber(lctx, -1) != 1) {
-    delete sptr;
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out = std::format(
-          "\"{}\" expects 3 args: integer (octagon id), number (x), number "
-          "(y)!",
-          name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
+  // "path" must be destructed before a possible "lua_error(...)".
+  std::optional<bool> ret;
+  {
+    std::string path;
+    if (lua_interface_helper_file_path(lctx, RECORDING_DIR, ".rec", &path)) {
+      ret = scene->start_recording(path);
     }
-
-    return lua_error(lctx);
+  }
+  if (!ret.has_value()) {
+    return lua_interface_helper_error(
+        lctx,
+        "expects 1 argument: string (name; up to 64 letters, digits, \"_\" or "
+        "\"-\")!");
   }
 
-  scene->apply_octagon_impulse(lua_tointeger(lctx, -3), lua_tonumber(lctx, -2),
-                               lua_tonumber(lctx, -1));
-
-  delete sptr;
-  return 0;
+  lua_pushboolean(lctx, ret.value() ? 1 : 0);
+  return 1;
 }
 
-int lua_interface_set_octagon_color(lua_State *lctx) {
-  std::weak_ptr<TDWSPtrHolder> *wptr =
-      reinterpret_cast<std::weak_ptr<TDWSPtrHolder> *>(
-          lua_touserdata(lctx, lua_upvalueindex(1)));
-
-  std::shared_ptr<TDWSPtrHolder> *sptr =
-      new std::shared_ptr<TDWSPtrHolder>(std::move(wptr->lock()));
+int lua_interface_stop_recording(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
+    return lua_error(lctx);
+  }
 
-  if (!(*sptr)) {
-    delete sptr;
+  bool ret = scene->stop_recording();
 
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" is only available in 2DSimulation Scene.", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
+  lua_pushboolean(lctx, ret ? 1 : 0);
+  return 1;
+}
 
+int lua_interface_start_replay(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
     return lua_error(lctx);
   }
-  TwoDimWorldScene *scene = (*sptr)->scene_ptr;
 
-  if (lua_gettop(lctx) < 4 || lua_gettop(lctx) > 5 ||
-      (lua_gettop(lctx) == 4 &&
-       (lua_isinteger(lctx, -4) != 1 || lua_isinteger(lctx, -3) != 1 ||
-        lua_isinteger(lctx, -2) != 1 || lua_isinteger(lctx, -1) != 1 ||
-        lua_tointeger(lctx, -3) < 0 || lua_tointeger(lctx, -3) > 255 ||
-        lua_tointeger(lctx, -2) < 0 || lua_tointeger(lctx, -2) > 255 ||
-        lua_tointeger(lctx, -1) < 0 || lua_tointeger(lctx, -1) > 255)) ||
-      (lua_gettop(lctx) == 5 &&
-       (lua_isinteger(lctx, -5) != 1 || lua_isinteger(lctx, -4) != 1 ||
-        lua_isinteger(lctx, -3) != 1 || lua_isinteger(lctx, -2) != 1 ||
-        lua_isinteger(lctx, -1) != 1 || lua_tointeger(lctx, -4) < 0 ||
-        lua_tointeger(lctx, -4) > 255 || lua_tointeger(lctx, -3) < 0 ||
-        lua_tointeger(lctx, -3) > 255 || lua_tointeger(lctx, -2) < 0 ||
-        lua_tointeger(lctx, -2) > 255 || lua_tointeger(lctx, -1) < 0 ||
-        lua_tointeger(lctx, -1) > 255))) {
-    delete sptr;
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out = std::format(
-          "\"{}\" expects 4-5 args: integer (octagon id), integer (red 0-255), "
-          "integer (green 0-255), integer (blue 0-255), integer (optional; "
-          "alpha 0-255)!",
-          name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
+  // "path" must be destructed before a possible "lua_error(...)".
+  std::optional<bool> ret;
+  {
+    std::string path;
+    if (lua_interface_helper_file_path(lctx, RECORDING_DIR, ".rec", &path)) {
+      ret = scene->start_replay(path);
     }
-
-    return lua_error(lctx);
   }
-
-  if (lua_gettop(lctx) == 4) {
-    scene->set_octagon_color(
-        lua_tointeger(lctx, -4),
-        Color{static_cast<uint8_t>(lua_tointeger(lctx, -3)),
-              static_cast<uint8_t>(lua_tointeger(lctx, -2)),
-              static_cast<uint8_t>(lua_tointeger(lctx, -1)), 255});
-  } else if (lua_gettop(lctx) == 5) {
-    scene->set_octagon_color(
-        lua_tointeger(lctx, -5),
-        Color{static_cast<uint8_t>(lua_tointeger(lctx, -4)),
-              static_cast<uint8_t>(lua_tointeger(lctx, -3)),
-              static_cast<uint8_t>(lua_tointeger(lctx, -2)),
-              static_cast<uint8_t>(lua_tointeger(lctx, -1))});
+  if (!ret.has_value()) {
+    return lua_interface_helper_error(
+        lctx,
+        "expects 1 argument: string (name; up to 64 letters, digits, \"_\" or "
+        "\"-\")!");
   }
 
-  delete sptr;
-  return 0;
+  lua_pushboolean(lctx, ret.value() ? 1 : 0);
+  return 1;
 }
 
-int lua_interface_create_trapezoid(lua_State *lctx) {
-  std::weak_ptr<TDWSPtrHolder> *wptr =
-      reinterpret_cast<std::weak_ptr<TDWSPtrHolder> *>(
-          lua_touserdata(lctx, lua_upvalueindex(1)));
-
-  std::shared_ptr<TDWSPtrHolder> *sptr =
-      new std::shared_ptr<TDWSPtrHolder>(std::move(wptr->lock()));
+int lua_interface_stop_replay(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
+    return lua_error(lctx);
+  }
 
-  if (!(*sptr)) {
-    delete sptr;
+  scene->stop_replay();
 
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" is only available in 2DSimulation Scene.", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
+  return 0;
+}
 
+int lua_interface_is_replaying(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
     return lua_error(lctx);
   }
-  TwoDimWorldScene *scene = (*sptr)->scene_ptr;
-
-  uint32_t id = scene->create_trapezoid();
 
-  lua_pushinteger(lctx, id);
-  delete sptr;
+  lua_pushboolean(lctx, scene->is_replaying() ? 1 : 0);
   return 1;
 }
 
-int lua_interface_destroy_trapezoid(lua_State *lctx) {
-  std::weak_ptr<TDWSPtrHolder> *wptr =
-      reinterpret_cast<std::weak_ptr<TDWSPtrHolder> *>(
-          lua_touserdata(lctx, lua_upvalueindex(1)));
-
-  std::shared_ptr<TDWSPtrHolder> *sptr =
-      new std::shared_ptr<TDWSPtrHolder>(std::move(wptr->lock()));
-
-  if (!(*sptr)) {
-    delete sptr;
-
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" is only available in 2DSimulation Scene.", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
-
+int lua_interface_get_pool_stats(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
     return lua_error(lctx);
   }
-  TwoDimWorldScene *scene = (*sptr)->scene_ptr;
-
-  if (lua_gettop(lctx) != 1 || lua_isinteger(lctx, -1) != 1) {
-    delete sptr;
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out = std::format(
-          "\"{}\" expects 1 argument: integer (trapezoid id).", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
 
-    return lua_error(lctx);
+  if (lua_gettop(lctx) != 1 || lua_type(lctx, 1) != LUA_TSTRING) {
+    return lua_interface_helper_error(lctx, "expects 1 arg: string (kind)!");
   }
 
-  bool ret = scene->destroy_trapezoid(lua_tointeger(lctx, -1));
+  std::optional<BodyKind> kind = body_kind_from_name(lua_tostring(lctx, 1));
+  if (!kind.has_value()) {
+    return lua_interface_helper_error(
+        lctx, "kind must be \"ball\", \"octagon\" or \"trapezoid\"!");
+  }
 
-  lua_pushboolean(lctx, ret ? 1 : 0);
-  delete sptr;
-  return 1;
+  const BodyPoolStats &stats = scene->get_body_pool_stats(kind.value());
+  lua_pushinteger(lctx, static_cast<lua_Integer>(stats.pooled));      // +1
+  lua_pushinteger(lctx, static_cast<lua_Integer>(stats.peak_live));   // +1
+  lua_pushinteger(lctx, static_cast<lua_Integer>(stats.reused));      // +1
+  lua_pushinteger(lctx, static_cast<lua_Integer>(stats.created));     // +1
+  return 4;
 }
 
-int lua_interface_get_trapezoid_pos(lua_State *lctx) {
-  std::weak_ptr<TDWSPtrHolder> *wptr =
-      reinterpret_cast<std::weak_ptr<TDWSPtrHolder> *>(
-          lua_touserdata(lctx, lua_upvalueindex(1)));
-
-  std::shared_ptr<TDWSPtrHolder> *sptr =
-      new std::shared_ptr<TDWSPtrHolder>(std::move(wptr->lock()));
-
-  if (!(*sptr)) {
-    delete sptr;
-
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" is only available in 2DSimulation Scene.", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
-
+int lua_interface_set_substeps(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
     return lua_error(lctx);
   }
-  TwoDimWorldScene *scene = (*sptr)->scene_ptr;
-
-  if (lua_gettop(lctx) != 1 || lua_isinteger(lctx, -1) != 1) {
-    delete sptr;
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" expects 1 integer argument trapezoid id!", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
 
-    return lua_error(lctx);
+  if (lua_gettop(lctx) != 2 || lua_isinteger(lctx, 1) != 1 ||
+      lua_isinteger(lctx, 2) != 1 || lua_tointeger(lctx, 1) < 1 ||
+      lua_tointeger(lctx, 2) < lua_tointeger(lctx, 1) ||
+      lua_tointeger(lctx, 2) > MAX_SUBSTEPS) {
+    return lua_interface_helper_error(
+        lctx,
+        "expects 2 args: integer (min substeps >= 1), integer (max substeps >= "
+        "min, <= 16)!");
   }
 
-  uint32_t idx = lua_tointeger(lctx, -1);
-
-  b2Vec2 pos = scene->get_trapezoid_pos(idx);
+  scene->set_substep_bounds(static_cast<int>(lua_tointeger(lctx, 1)),
+                            static_cast<int>(lua_tointeger(lctx, 2)));
 
-  lua_pushnumber(lctx, pos.x);
-  lua_pushnumber(lctx, pos.y);
-
-  delete sptr;
-  return 2;
+  return 0;
 }
 
-int lua_interface_set_trapezoid_pos(lua_State *lctx) {
-  std::weak_ptr<TDWSPtrHolder> *wptr =
-      reinterpret_cast<std::weak_ptr<TDWSPtrHolder> *>(
-          lua_touserdata(lctx, lua_upvalueindex(1)));
-
-  std::shared_ptr<TDWSPtrHolder> *sptr =
-      new std::shared_ptr<TDWSPtrHolder>(std::move(wptr->lock()));
-
-  if (!(*sptr)) {
-    delete sptr;
+int lua_interface_get_substeps(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
+    return lua_error(lctx);
+  }
 
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" is only available in 2DSimulation Scene.", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
+  lua_pushinteger(lctx, scene->get_substep_count());  // +1
+  lua_pushinteger(lctx, scene->get_min_substeps());   // +1
+  lua_pushinteger(lctx, scene->get_max_substeps());   // +1
+  return 3;
+}
 
+int lua_interface_get_degrade_level(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
     return lua_error(lctx);
   }
-  TwoDimWorldScene *scene = (*sptr)->scene_ptr;
 
-  if (lua_gettop(lctx) != 3 || lua_isinteger(lctx, -3) != 1 ||
-      lua_isnumber(lctx, -2) != 1 || lua_isnumber(lctx, -1) != 1) {
-    delete sptr;
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out = std::format(
-          "\"{}\" expects 3 args: integer (trapezoid id), number (x pos), "
-          "number (y pos)!",
-          name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
+  const int level = static_cast<int>(scene->get_degrade_level());
+  lua_pushinteger(lctx, level);                      // +1
+  lua_pushstring(lctx, DEGRADE_LEVEL_NAMES[level]);  // +1
+  return 2;
+}
 
+int lua_interface_reset(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
     return lua_error(lctx);
   }
 
-  scene->set_trapezoid_pos(lua_tointeger(lctx, -3), lua_tonumber(lctx, -2),
-                           lua_tonumber(lctx, -1));
+  scene->reset();
 
-  delete sptr;
   return 0;
 }
 
-int lua_interface_get_trapezoid_vel(lua_State *lctx) {
-  std::weak_ptr<TDWSPtrHolder> *wptr =
-      reinterpret_cast<std::weak_ptr<TDWSPtrHolder> *>(
-          lua_touserdata(lctx, lua_upvalueindex(1)));
-
-  std::shared_ptr<TDWSPtrHolder> *sptr =
-      new std::shared_ptr<TDWSPtrHolder>(std::move(wptr->lock()));
-
-  if (!(*sptr)) {
-    delete sptr;
-
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" is only available in 2DSimulation Scene.", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
-
+int lua_interface_load_terrain(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
     return lua_error(lctx);
   }
-  TwoDimWorldScene *scene = (*sptr)->scene_ptr;
 
-  if (lua_gettop(lctx) != 1 || lua_isinteger(lctx, -1) != 1) {
-    delete sptr;
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" expects 1 integer argument trapezoid id!", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
+  // "path" must be destructed before a possible "lua_error(...)".
+  std::optional<bool> ret;
+  {
+    std::string path;
+    if (lua_interface_helper_file_path(lctx, TERRAIN_DIR, ".terrain", &path)) {
+      ret = scene->load_terrain(path);
     }
-
-    return lua_error(lctx);
+  }
+  if (!ret.has_value()) {
+    return lua_interface_helper_error(
+        lctx,
+        "expects 1 argument: string (name; up to 64 letters, digits, \"_\" or "
+        "\"-\")!");
   }
 
-  uint32_t idx = lua_tointeger(lctx, -1);
-
-  b2Vec2 vel = scene->get_trapezoid_vel(idx);
+  lua_pushboolean(lctx, ret.value() ? 1 : 0);
+  return 1;
+}
 
-  lua_pushnumber(lctx, vel.x);
-  lua_pushnumber(lctx, vel.y);
+int lua_interface_get_terrain_info(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
+    return lua_error(lctx);
+  }
 
-  delete sptr;
+  lua_pushinteger(lctx, scene->get_terrain_loaded_count());  // +1
+  lua_pushinteger(lctx, scene->get_terrain_chunk_count());   // +1
   return 2;
 }
 
-int lua_interface_apply_trapezoid_impulse(lua_State *lctx) {
-  std::weak_ptr<TDWSPtrHolder> *wptr =
-      reinterpret_cast<std::weak_ptr<TDWSPtrHolder> *>(
-          lua_touserdata(lctx, lua_upvalueindex(1)));
+int lua_interface_emit_particles(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
+    return lua_error(lctx);
+  }
 
-  std::shared_ptr<TDWSPtrHolder> *sptr =
-      new std::shared_ptr<TDWSPtrHolder>(std::move(wptr->lock()));
+  ParticleParams params;
+  const int top = lua_gettop(lctx);
+  if (top < 3 || top > 4 || !lua_interface_helper_is_finite(lctx, 1) ||
+      !lua_interface_helper_is_finite(lctx, 2) ||
+      lua_isinteger(lctx, 3) != 1 || lua_tointeger(lctx, 3) < 0 ||
+      !lua_interface_helper_get_particle_params(lctx, 4, &params)) {
+    return lua_interface_helper_error(
+        lctx,
+        "expects 3-4 args: number (x), number (y), integer (count), table "
+        "(optional; vx, vy, speed, angle, spread, life > 0, color)!");
+  }
 
-  if (!(*sptr)) {
-    delete sptr;
+  const size_t emitted = scene->get_particles().emit(
+      b2Vec2{static_cast<float>(lua_tonumber(lctx, 1)),
+             static_cast<float>(lua_tonumber(lctx, 2))},
+      static_cast<size_t>(lua_tointeger(lctx, 3)), params);
 
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" is only available in 2DSimulation Scene.", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
+  lua_pushinteger(lctx, static_cast<lua_Integer>(emitted));
+  return 1;
+}
 
+int lua_interface_create_emitter(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
     return lua_error(lctx);
   }
-  TwoDimWorldScene *scene = (*sptr)->scene_ptr;
-
-  if (lua_gettop(lctx) != 3 || lua_isinteger(lctx, -3) != 1 ||
-      lua_isnumber(lctx, -2) != 1 || lua_isnumber(lctx, -1) != 1) {
-    delete sptr;
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out = std::format(
-          "\"{}\" 3 args: integer (trapezoid id), number (x), number (y)!",
-          name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
 
-    return lua_error(lctx);
+  ParticleParams params;
+  const int top = lua_gettop(lctx);
+  if (top < 3 || top > 4 || !lua_interface_helper_is_finite(lctx, 1) ||
+      !lua_interface_helper_is_finite(lctx, 2) ||
+      !lua_interface_helper_is_finite(lctx, 3) ||
+      lua_tonumber(lctx, 3) < 0.0 ||
+      lua_tonumber(lctx, 3) > PARTICLE_MAX_RATE ||
+      !lua_interface_helper_get_particle_params(lctx, 4, &params)) {
+    return lua_interface_helper_error(
+        lctx,
+        "expects 3-4 args: number (x), number (y), number (particles per "
+        "second 0-65536), table (optional; vx, vy, speed, angle, spread, life "
+        "> 0, color)!");
   }
 
-  scene->apply_trapezoid_impulse(
-      lua_tointeger(lctx, -3), lua_tonumber(lctx, -2), lua_tonumber(lctx, -1));
+  const uint32_t id = scene->get_particles().create_emitter(
+      b2Vec2{static_cast<float>(lua_tonumber(lctx, 1)),
+             static_cast<float>(lua_tonumber(lctx, 2))},
+      static_cast<float>(lua_tonumber(lctx, 3)), params);
 
-  delete sptr;
-  return 0;
+  lua_pushinteger(lctx, id);
+  return 1;
 }
 
-int lua_interface_set_trapezoid_color(lua_State *lctx) {
-  std::weak_ptr<TDWSPtrHolder> *wptr =
-      reinterpret_cast<std::weak_ptr<TDWSPtrHolder> *>(
-          lua_touserdata(lctx, lua_upvalueindex(1)));
+int lua_interface_set_emitter_pos(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
+    return lua_error(lctx);
+  }
 
-  std::shared_ptr<TDWSPtrHolder> *sptr =
-      new std::shared_ptr<TDWSPtrHolder>(std::move(wptr->lock()));
+  if (lua_gettop(lctx) != 3 || lua_isinteger(lctx, 1) != 1 ||
+      !lua_interface_helper_is_finite(lctx, 2) ||
+      !lua_interface_helper_is_finite(lctx, 3)) {
+    return lua_interface_helper_error(
+        lctx, "expects 3 args: integer (emitter id), number (x), number (y)!");
+  }
 
-  if (!(*sptr)) {
-    delete sptr;
+  bool ret = scene->get_particles().set_emitter_pos(
+      static_cast<uint32_t>(lua_tointeger(lctx, 1)),
+      b2Vec2{static_cast<float>(lua_tonumber(lctx, 2)),
+             static_cast<float>(lua_tonumber(lctx, 3))});
 
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out =
-          std::format("\"{}\" is only available in 2DSimulation Scene.", name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
+  lua_pushboolean(lctx, ret ? 1 : 0);
+  return 1;
+}
 
+int lua_interface_destroy_emitter(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
     return lua_error(lctx);
   }
-  TwoDimWorldScene *scene = (*sptr)->scene_ptr;
-
-  if (lua_gettop(lctx) < 4 || lua_gettop(lctx) > 5 ||
-      (lua_gettop(lctx) == 4 &&
-       (lua_isinteger(lctx, -4) != 1 || lua_isinteger(lctx, -3) != 1 ||
-        lua_isinteger(lctx, -2) != 1 || lua_isinteger(lctx, -1) != 1 ||
-        lua_tointeger(lctx, -3) < 0 || lua_tointeger(lctx, -3) > 255 ||
-        lua_tointeger(lctx, -2) < 0 || lua_tointeger(lctx, -2) > 255 ||
-        lua_tointeger(lctx, -1) < 0 || lua_tointeger(lctx, -1) > 255)) ||
-      (lua_gettop(lctx) == 5 &&
-       (lua_isinteger(lctx, -5) != 1 || lua_isinteger(lctx, -4) != 1 ||
-        lua_isinteger(lctx, -3) != 1 || lua_isinteger(lctx, -2) != 1 ||
-        lua_isinteger(lctx, -1) != 1 || lua_tointeger(lctx, -4) < 0 ||
-        lua_tointeger(lctx, -4) > 255 || lua_tointeger(lctx, -3) < 0 ||
-        lua_tointeger(lctx, -3) > 255 || lua_tointeger(lctx, -2) < 0 ||
-        lua_tointeger(lctx, -2) > 255 || lua_tointeger(lctx, -1) < 0 ||
-        lua_tointeger(lctx, -1) > 255))) {
-    delete sptr;
-    {
-      const char *name = lua_tostring(lctx, lua_upvalueindex(2));
-      std::string out = std::format(
-          "\"{}\" expects 4-5 args: integer (trapezoid id), integer (red "
-          "0-255), "
-          "integer (green 0-255), integer (blue 0-255), integer (optional; "
-          "alpha 0-255)!",
-          name);
-      std::println(stdout, "{}", out);
-      lua_pushstring(lctx, out.c_str());
-    }
 
-    return lua_error(lctx);
+  if (lua_gettop(lctx) != 1 || lua_isinteger(lctx, 1) != 1) {
+    return lua_interface_helper_error(
+        lctx, "expects 1 arg: integer (emitter id)!");
   }
 
-  if (lua_gettop(lctx) == 4) {
-    scene->set_trapezoid_color(
-        lua_tointeger(lctx, -4),
-        Color{static_cast<uint8_t>(lua_tointeger(lctx, -3)),
-              static_cast<uint8_t>(lua_tointeger(lctx, -2)),
-              static_cast<uint8_t>(lua_tointeger(lctx, -1)), 255});
-  } else if (lua_gettop(lctx) == 5) {
-    scene->set_trapezoid_color(
-        lua_tointeger(lctx, -5),
-        Color{static_cast<uint8_t>(lua_tointeger(lctx, -4)),
-              static_cast<uint8_t>(lua_tointeger(lctx, -3)),
-              static_cast<uint8_t>(lua_tointeger(lctx, -2)),
-              static_cast<uint8_t>(lua_tointeger(lctx, -1))});
+  bool ret = scene->get_particles().destroy_emitter(
+      static_cast<uint32_t>(lua_tointeger(lctx, 1)));
+
+  lua_pushboolean(lctx, ret ? 1 : 0);
+  return 1;
+}
+
+int lua_interface_get_particle_count(lua_State *lctx) {
+  TwoDimWorldScene *scene = lua_interface_helper_get_scene(lctx);
+  if (!scene) {
+    return lua_error(lctx);
   }
 
-  delete sptr;
-  return 0;
+  lua_pushinteger(lctx,
+                  static_cast<lua_Integer>(scene->get_particles().size()));
+  return 1;
 }
 
 int lua_interface_get_pixel_b2_ratio(lua_State *lctx) {
@@ -1030,48 +1415,110 @@ int lua_interface_get_pixel_b2_ratio(lua_State *lctx) {
   return 1;
 }
 
-int lua_interface_helper_cleanup_ptr_holder(lua_State *lctx) {
-  std::weak_ptr<TDWSPtrHolder> *wptr_ptr =
-      reinterpret_cast<std::weak_ptr<TDWSPtrHolder> *>(
-          lua_touserdata(lctx, -1));
-
-  wptr_ptr->std::weak_ptr<TDWSPtrHolder>::~weak_ptr();
-
-  return 0;
-}
-
-// Lua: -0, +1
-void lua_interface_helper_push_ptr_holder(lua_State *lctx,
-                                          std::weak_ptr<TDWSPtrHolder> wptr) {
-  void *alloc_buf =
-      lua_newuserdatauv(lctx, sizeof(std::weak_ptr<TDWSPtrHolder>), 0);  // +1
-  std::weak_ptr<TDWSPtrHolder> *wptr_ptr =
-      new (alloc_buf) std::weak_ptr<TDWSPtrHolder>(wptr);
+// Lua: -0, +0
+// Writes "pairs" into arrays "<prefix>_a" and "<prefix>_b" of the table at
+// "idx" and their length into "<prefix>_n". The arrays are reused between
+// calls, entries past "<prefix>_n" are stale.
+void lua_interface_helper_write_event_pairs(
+    lua_State *lctx, int idx, const char *prefix,
+    const std::vector<std::pair<int64_t, int64_t> > &pairs) {
+  idx = lua_absindex(lctx, idx);
+  for (int side = 0; side < 2; ++side) {
+    {
+      std::string name = std::format("{}_{}", prefix, side == 0 ? 'a' : 'b');
+      if (lua_getfield(lctx, idx, name.c_str()) != LUA_TTABLE) {  // +1
+        lua_pop(lctx, 1);                                         // -1
+        lua_createtable(lctx, static_cast<int>(pairs.size()), 0);  // +1
+        lua_pushvalue(lctx, -1);                                   // +1
+        lua_setfield(lctx, idx, name.c_str());                     // -1
+      }
+    }
+    for (size_t pair_idx = 0; pair_idx < pairs.size(); ++pair_idx) {
+      lua_pushinteger(lctx, side == 0 ? pairs[pair_idx].first
+                                      : pairs[pair_idx].second);  // +1
+      lua_rawseti(lctx, -2, static_cast<lua_Integer>(pair_idx + 1));  // -1
+    }
+    lua_pop(lctx, 1);  // -1
+  }
 
-  lua_newtable(lctx);                                                // +1
-  lua_pushcfunction(lctx, lua_interface_helper_cleanup_ptr_holder);  // +1
-  lua_setfield(lctx, -2, "__gc");                                    // -1
-  lua_setmetatable(lctx, -2);                                        // -1
+  {
+    std::string name = std::format("{}_n", prefix);
+    lua_pushinteger(lctx, static_cast<lua_Integer>(pairs.size()));  // +1
+    lua_setfield(lctx, idx, name.c_str());                          // -1
+  }
 }
 
 TwoDimWorldScene::TwoDimWorldScene(SceneSystem *ctx)
     : Scene(ctx),
       lua_error_text{},
-      ptr_ctx(std::make_shared<TDWSPtrHolder>(this)),
-      rand_e(std::random_device()()),
+      lua_handle(acquire_lua_handle(this)),
+      lua_state(nullptr),
+      task_pool(std::make_unique<TaskPool>(
+          ctx->get_sim_settings().physics_thread_count)),
+      bodies(),
+      instanced_renderer(std::make_unique<InstancedShapeRenderer>()),
+      instance_buffer(),
+      transform_buffer(),
+      vertex_buffer(),
+      visible_indices(),
+      camera{Vector2{0.0F, 0.0F}, Vector2{0.0F, 0.0F}, 0.0F, 1.0F},
+      sensors(),
+      contact_begin_events(),
+      contact_end_events(),
+      sensor_begin_events(),
+      sensor_end_events(),
+      query_results(),
+      ray_hits(),
+      query_aabb_bounds{b2Vec2{0.0F, 0.0F}, b2Vec2{0.0F, 0.0F}},
+      sensor_idx_counter(0),
+      input_recorder(),
+      input_replayer(),
+      input_frame{0.0F, {}, 0, {}, false},
+      recording_path(),
+      rng_seed(std::random_device()()),
+      rand_e(rng_seed),
       real_dist(),
-      ball_idx_counter(0),
-      octagon_idx_counter(0),
-      trapezoid_idx_counter(0) {
+      body_pools(),
+      released_bodies(),
+      body_pool_stats(),
+      body_pool_size(static_cast<size_t>(
+          std::max(ctx->get_sim_settings().body_pool_size, 0))),
+      wall_half_height(WALL_HH),
+      step_accumulator(0.0F),
+      interp_alpha(1.0F),
+      update_timings{0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F},
+      terrain(),
+      terrain_keys(),
+      terrain_body_ranges(),
+      terrain_refresh_countdown(0),
+      min_substeps(std::clamp(ctx->get_sim_settings().min_substeps, 1,
+                              MAX_SUBSTEPS)),
+      max_substeps(std::clamp(ctx->get_sim_settings().max_substeps,
+                              min_substeps, MAX_SUBSTEPS)),
+      settings_min_substeps(ctx->get_sim_settings().min_substeps),
+      settings_max_substeps(ctx->get_sim_settings().max_substeps),
+      substep_count(std::clamp(SUBSTEP_BASELINE, min_substeps, max_substeps)),
+      max_body_speed_sq(0.0F),
+      touching_contacts(0),
+      degrade_level(DegradeLevel::NONE),
+      lua_update_countdown(0),
+      lua_update_dt(0.0F),
+      particles() {
   if (!ctx->get_map_value("lua_state").has_value()) {
     ctx->init_lua();
   }
+  lua_state =
+      reinterpret_cast<lua_State *>(ctx->get_map_value("lua_state").value());
 
   // Create Box2D World
   b2WorldDef world_def = b2DefaultWorldDef();
 
   world_def.userData = ctx;
   world_def.gravity = b2Vec2{0.0F, 10.0F};
+  world_def.workerCount = task_pool->get_thread_count();
+  world_def.enqueueTask = TaskPool::enqueue_task;
+  world_def.finishTask = TaskPool::finish_task;
+  world_def.userTaskContext = task_pool.get();
 
   this->world_id = b2CreateWorld(&world_def);
 
@@ -1088,27 +1535,25 @@ TwoDimWorldScene::TwoDimWorldScene(SceneSystem *ctx)
   b2CreatePolygonShape(this->ground_id, &ground_shape_def, &ground_box);
 
   // Create Box2D Walls
-  b2BodyDef wall_body_def = b2DefaultBodyDef();
-  wall_body_def.position = b2Vec2{LWALL_X, LWALL_Y};
-  this->left_wall_id = b2CreateBody(this->world_id, &wall_body_def);
-
-  b2Polygon wall_box = b2MakeBox(WALL_HW, WALL_HH);
-  b2ShapeDef wall_shape_def = b2DefaultShapeDef();
-  wall_shape_def.material.restitution = 0.8F;
-  b2CreatePolygonShape(this->left_wall_id, &wall_shape_def, &wall_box);
+  create_walls();
+
+  init_prototypes();
+  init_instanced_meshes();
+
+  // Fill the pools up front so early spawns don't pay for body creation.
+  for (int kind = 0; kind < BODY_KIND_COUNT; ++kind) {
+    const BodyKind body_kind = static_cast<BodyKind>(kind);
+    b2BodyDef body_def = prototypes[kind].body_def;
+    body_def.isEnabled = false;
+    body_pools[kind].reserve(body_pool_size);
+    for (size_t idx = 0; idx < body_pool_size; ++idx) {
+      body_pools[kind].push_back(create_prototype_body(body_kind, body_def));
+    }
+    body_pool_stats[kind].pooled = body_pool_size;
+  }
 
-  wall_body_def = b2DefaultBodyDef();
-  wall_body_def.position = b2Vec2{RWALL_X, RWALL_Y};
-  this->right_wall_id = b2CreateBody(this->world_id, &wall_body_def);
-
-  wall_box = b2MakeBox(WALL_HW, WALL_HH);
-  wall_shape_def = b2DefaultShapeDef();
-  wall_shape_def.material.restitution = 0.8F;
-  b2CreatePolygonShape(this->right_wall_id, &wall_shape_def, &wall_box);
-
-  // Set up Lua stuff
-  lua_State *lua_ctx =
-      reinterpret_cast<lua_State *>(ctx->get_map_value("lua_state").value());
+  // Set up Lua stuff
+  lua_State *lua_ctx = lua_state;
 
   lua_getglobal(lua_ctx, "scene_2d");  // +1
   if (lua_istable(lua_ctx, -1) != 1) {
@@ -1119,113 +1564,185 @@ TwoDimWorldScene::TwoDimWorldScene(SceneSystem *ctx)
     lua_pop(lua_ctx, 1);  // -1
   }
 
+  // Body userdata of a previous scene must not be handed out again.
+  reset_lua_body_cache();
+  // Methods don't depend on the scene, so the metatable is shared by every
+  // scene using this Lua state.
+  if (luaL_newmetatable(lua_ctx, LUA_BODY_METATABLE) == 1) {  // +1
+    lua_newtable(lua_ctx);                                    // +1
+    for (const auto &[name, function] : LUA_BODY_METHODS) {
+      const std::string full_name = std::format("body:{}", name);
+      lua_pushnil(lua_ctx);                        // +1
+      lua_pushstring(lua_ctx, full_name.c_str());  // +1
+      lua_pushcclosure(lua_ctx, function, 2);      // -2, +1
+      lua_setfield(lua_ctx, -2, name);             // -1
+    }
+    lua_setfield(lua_ctx, -2, "__index");  // -1
+  }
+  lua_pop(lua_ctx, 1);  // -1
+
   lua_getglobal(lua_ctx, "scene_2d");  // +1
 
-  lua_interface_helper_push_ptr_holder(lua_ctx, ptr_ctx);   // +1
-  lua_pushstring(lua_ctx, "createball");                    // +1
-  lua_pushcclosure(lua_ctx, lua_interface_create_ball, 2);  // -2, +1
-  lua_setfield(lua_ctx, -2, "createball");                  // -1
-
-  lua_interface_helper_push_ptr_holder(lua_ctx, ptr_ctx);    // +1
-  lua_pushstring(lua_ctx, "destroyball");                    // +1
-  lua_pushcclosure(lua_ctx, lua_interface_destroy_ball, 2);  // -2, +1
-  lua_setfield(lua_ctx, -2, "destroyball");                  // -1
-
-  lua_interface_helper_push_ptr_holder(lua_ctx, ptr_ctx);    // +1
-  lua_pushstring(lua_ctx, "getballpos");                     // +1
-  lua_pushcclosure(lua_ctx, lua_interface_get_ball_pos, 2);  // -2, +1
-  lua_setfield(lua_ctx, -2, "getballpos");                   // -1
-
-  lua_interface_helper_push_ptr_holder(lua_ctx, ptr_ctx);    // +1
-  lua_pushstring(lua_ctx, "setballpos");                     // +1
-  lua_pushcclosure(lua_ctx, lua_interface_set_ball_pos, 2);  // -2, +1
-  lua_setfield(lua_ctx, -2, "setballpos");                   // -1
-
-  lua_interface_helper_push_ptr_holder(lua_ctx, ptr_ctx);    // +1
-  lua_pushstring(lua_ctx, "getballvel");                     // +1
-  lua_pushcclosure(lua_ctx, lua_interface_get_ball_vel, 2);  // -2, +1
-  lua_setfield(lua_ctx, -2, "getballvel");                   // -1
-
-  lua_interface_helper_push_ptr_holder(lua_ctx, ptr_ctx);          // +1
-  lua_pushstring(lua_ctx, "applyballimpulse");                     // +1
-  lua_pushcclosure(lua_ctx, lua_interface_apply_ball_impulse, 2);  // -2, +1
-  lua_setfield(lua_ctx, -2, "applyballimpulse");                   // -1
-
-  lua_interface_helper_push_ptr_holder(lua_ctx, ptr_ctx);      // +1
-  lua_pushstring(lua_ctx, "setballcolor");                     // +1
-  lua_pushcclosure(lua_ctx, lua_interface_set_ball_color, 2);  // -2, +1
-  lua_setfield(lua_ctx, -2, "setballcolor");                   // -1
-
-  lua_interface_helper_push_ptr_holder(lua_ctx, ptr_ctx);      // +1
-  lua_pushstring(lua_ctx, "createoctagon");                    // +1
-  lua_pushcclosure(lua_ctx, lua_interface_create_octagon, 2);  // -2, +1
-  lua_setfield(lua_ctx, -2, "createoctagon");                  // -1
-
-  lua_interface_helper_push_ptr_holder(lua_ctx, ptr_ctx);       // +1
-  lua_pushstring(lua_ctx, "destroyoctagon");                    // +1
-  lua_pushcclosure(lua_ctx, lua_interface_destroy_octagon, 2);  // -2, +1
-  lua_setfield(lua_ctx, -2, "destroyoctagon");                  // -1
-
-  lua_interface_helper_push_ptr_holder(lua_ctx, ptr_ctx);       // +1
-  lua_pushstring(lua_ctx, "getoctagonpos");                     // +1
-  lua_pushcclosure(lua_ctx, lua_interface_get_octagon_pos, 2);  // -2, +1
-  lua_setfield(lua_ctx, -2, "getoctagonpos");                   // -1
-
-  lua_interface_helper_push_ptr_holder(lua_ctx, ptr_ctx);       // +1
-  lua_pushstring(lua_ctx, "setoctagonpos");                     // +1
-  lua_pushcclosure(lua_ctx, lua_interface_set_octagon_pos, 2);  // -2, +1
-  lua_setfield(lua_ctx, -2, "setoctagonpos");                   // -1
-
-  lua_interface_helper_push_ptr_holder(lua_ctx, ptr_ctx);       // +1
-  lua_pushstring(lua_ctx, "getoctagonvel");                     // +1
-  lua_pushcclosure(lua_ctx, lua_interface_get_octagon_vel, 2);  // -2, +1
-  lua_setfield(lua_ctx, -2, "getoctagonvel");                   // -1
-
-  lua_interface_helper_push_ptr_holder(lua_ctx, ptr_ctx);             // +1
-  lua_pushstring(lua_ctx, "applyoctagonimpulse");                     // +1
-  lua_pushcclosure(lua_ctx, lua_interface_apply_octagon_impulse, 2);  // -2, +1
-  lua_setfield(lua_ctx, -2, "applyoctagonimpulse");                   // -1
-
-  lua_interface_helper_push_ptr_holder(lua_ctx, ptr_ctx);         // +1
-  lua_pushstring(lua_ctx, "setoctagoncolor");                     // +1
-  lua_pushcclosure(lua_ctx, lua_interface_set_octagon_color, 2);  // -2, +1
-  lua_setfield(lua_ctx, -2, "setoctagoncolor");                   // -1
-
-  lua_interface_helper_push_ptr_holder(lua_ctx, ptr_ctx);        // +1
-  lua_pushstring(lua_ctx, "createtrapezoid");                    // +1
-  lua_pushcclosure(lua_ctx, lua_interface_create_trapezoid, 2);  // -2, +1
-  lua_setfield(lua_ctx, -2, "createtrapezoid");                  // -1
-
-  lua_interface_helper_push_ptr_holder(lua_ctx, ptr_ctx);         // +1
-  lua_pushstring(lua_ctx, "destroytrapezoid");                    // +1
-  lua_pushcclosure(lua_ctx, lua_interface_destroy_trapezoid, 2);  // -2, +1
-  lua_setfield(lua_ctx, -2, "destroytrapezoid");                  // -1
-
-  lua_interface_helper_push_ptr_holder(lua_ctx, ptr_ctx);         // +1
-  lua_pushstring(lua_ctx, "gettrapezoidpos");                     // +1
-  lua_pushcclosure(lua_ctx, lua_interface_get_trapezoid_pos, 2);  // -2, +1
-  lua_setfield(lua_ctx, -2, "gettrapezoidpos");                   // -1
-
-  lua_interface_helper_push_ptr_holder(lua_ctx, ptr_ctx);         // +1
-  lua_pushstring(lua_ctx, "settrapezoidpos");                     // +1
-  lua_pushcclosure(lua_ctx, lua_interface_set_trapezoid_pos, 2);  // -2, +1
-  lua_setfield(lua_ctx, -2, "settrapezoidpos");                   // -1
-
-  lua_interface_helper_push_ptr_holder(lua_ctx, ptr_ctx);         // +1
-  lua_pushstring(lua_ctx, "gettrapezoidvel");                     // +1
-  lua_pushcclosure(lua_ctx, lua_interface_get_trapezoid_vel, 2);  // -2, +1
-  lua_setfield(lua_ctx, -2, "gettrapezoidvel");                   // -1
-
-  lua_interface_helper_push_ptr_holder(lua_ctx, ptr_ctx);  // +1
-  lua_pushstring(lua_ctx, "applytrapezoidimpulse");        // +1
-  lua_pushcclosure(lua_ctx, lua_interface_apply_trapezoid_impulse,
-                   2);                                 // -2, +1
-  lua_setfield(lua_ctx, -2, "applytrapezoidimpulse");  // -1
-
-  lua_interface_helper_push_ptr_holder(lua_ctx, ptr_ctx);           // +1
-  lua_pushstring(lua_ctx, "settrapezoidcolor");                     // +1
-  lua_pushcclosure(lua_ctx, lua_interface_set_trapezoid_color, 2);  // -2, +1
-  lua_setfield(lua_ctx, -2, "settrapezoidcolor");                   // -1
+  for (const LuaBodyFunction &function : LUA_BODY_FUNCTIONS) {
+    for (size_t kind = 0; kind < BODY_KIND_COUNT; ++kind) {
+      const std::string name = std::format(
+          "{}{}{}", function.prefix, BODY_KIND_NAMES[kind], function.suffix);
+      lua_pushinteger(lua_ctx, lua_handle);                    // +1
+      lua_pushstring(lua_ctx, name.c_str());                   // +1
+      lua_pushcclosure(lua_ctx, function.functions[kind], 2);  // -2, +1
+      lua_setfield(lua_ctx, -2, name.c_str());                 // -1
+    }
+  }
+
+  lua_pushinteger(lua_ctx, lua_handle);               // +1
+  lua_pushstring(lua_ctx, "spawn");                   // +1
+  lua_pushcclosure(lua_ctx, lua_interface_spawn, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "spawn");                 // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                    // +1
+  lua_pushstring(lua_ctx, "setcamera");                    // +1
+  lua_pushcclosure(lua_ctx, lua_interface_set_camera, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "setcamera");                  // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                       // +1
+  lua_pushstring(lua_ctx, "createsensor");                    // +1
+  lua_pushcclosure(lua_ctx, lua_interface_create_sensor, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "createsensor");                  // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                        // +1
+  lua_pushstring(lua_ctx, "destroysensor");                    // +1
+  lua_pushcclosure(lua_ctx, lua_interface_destroy_sensor, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "destroysensor");                  // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                    // +1
+  lua_pushstring(lua_ctx, "queryaabb");                    // +1
+  lua_pushcclosure(lua_ctx, lua_interface_query_aabb, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "queryaabb");                  // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                      // +1
+  lua_pushstring(lua_ctx, "querycircle");                    // +1
+  lua_pushcclosure(lua_ctx, lua_interface_query_circle, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "querycircle");                  // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                 // +1
+  lua_pushstring(lua_ctx, "raycast");                   // +1
+  lua_pushcclosure(lua_ctx, lua_interface_raycast, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "raycast");                 // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                       // +1
+  lua_pushstring(lua_ctx, "getpositions");                    // +1
+  lua_pushcclosure(lua_ctx, lua_interface_get_positions, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "getpositions");                  // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                        // +1
+  lua_pushstring(lua_ctx, "getvelocities");                    // +1
+  lua_pushcclosure(lua_ctx, lua_interface_get_velocities, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "getvelocities");                  // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                  // +1
+  lua_pushstring(lua_ctx, "body");                       // +1
+  lua_pushcclosure(lua_ctx, lua_interface_get_body, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "body");                     // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                       // +1
+  lua_pushstring(lua_ctx, "savesnapshot");                    // +1
+  lua_pushcclosure(lua_ctx, lua_interface_save_snapshot, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "savesnapshot");                  // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                       // +1
+  lua_pushstring(lua_ctx, "loadsnapshot");                    // +1
+  lua_pushcclosure(lua_ctx, lua_interface_load_snapshot, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "loadsnapshot");                  // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                  // +1
+  lua_pushstring(lua_ctx, "setseed");                    // +1
+  lua_pushcclosure(lua_ctx, lua_interface_set_seed, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "setseed");                  // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                         // +1
+  lua_pushstring(lua_ctx, "startrecording");                    // +1
+  lua_pushcclosure(lua_ctx, lua_interface_start_recording, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "startrecording");                  // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                        // +1
+  lua_pushstring(lua_ctx, "stoprecording");                    // +1
+  lua_pushcclosure(lua_ctx, lua_interface_stop_recording, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "stoprecording");                  // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                      // +1
+  lua_pushstring(lua_ctx, "startreplay");                    // +1
+  lua_pushcclosure(lua_ctx, lua_interface_start_replay, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "startreplay");                  // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                     // +1
+  lua_pushstring(lua_ctx, "stopreplay");                    // +1
+  lua_pushcclosure(lua_ctx, lua_interface_stop_replay, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "stopreplay");                  // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                      // +1
+  lua_pushstring(lua_ctx, "isreplaying");                    // +1
+  lua_pushcclosure(lua_ctx, lua_interface_is_replaying, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "isreplaying");                  // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                        // +1
+  lua_pushstring(lua_ctx, "getpoolstats");                     // +1
+  lua_pushcclosure(lua_ctx, lua_interface_get_pool_stats, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "getpoolstats");                   // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                      // +1
+  lua_pushstring(lua_ctx, "setsubsteps");                    // +1
+  lua_pushcclosure(lua_ctx, lua_interface_set_substeps, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "setsubsteps");                  // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                      // +1
+  lua_pushstring(lua_ctx, "getsubsteps");                    // +1
+  lua_pushcclosure(lua_ctx, lua_interface_get_substeps, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "getsubsteps");                  // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                           // +1
+  lua_pushstring(lua_ctx, "getdegradelevel");                     // +1
+  lua_pushcclosure(lua_ctx, lua_interface_get_degrade_level, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "getdegradelevel");                   // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);               // +1
+  lua_pushstring(lua_ctx, "reset");                   // +1
+  lua_pushcclosure(lua_ctx, lua_interface_reset, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "reset");                 // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                      // +1
+  lua_pushstring(lua_ctx, "loadterrain");                    // +1
+  lua_pushcclosure(lua_ctx, lua_interface_load_terrain, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "loadterrain");                  // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                          // +1
+  lua_pushstring(lua_ctx, "getterraininfo");                     // +1
+  lua_pushcclosure(lua_ctx, lua_interface_get_terrain_info, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "getterraininfo");                   // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                        // +1
+  lua_pushstring(lua_ctx, "emitparticles");                    // +1
+  lua_pushcclosure(lua_ctx, lua_interface_emit_particles, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "emitparticles");                  // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                        // +1
+  lua_pushstring(lua_ctx, "createemitter");                    // +1
+  lua_pushcclosure(lua_ctx, lua_interface_create_emitter, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "createemitter");                  // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                         // +1
+  lua_pushstring(lua_ctx, "setemitterpos");                     // +1
+  lua_pushcclosure(lua_ctx, lua_interface_set_emitter_pos, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "setemitterpos");                   // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                         // +1
+  lua_pushstring(lua_ctx, "destroyemitter");                    // +1
+  lua_pushcclosure(lua_ctx, lua_interface_destroy_emitter, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "destroyemitter");                  // -1
+
+  lua_pushinteger(lua_ctx, lua_handle);                            // +1
+  lua_pushstring(lua_ctx, "getparticlecount");                     // +1
+  lua_pushcclosure(lua_ctx, lua_interface_get_particle_count, 2);  // -2, +1
+  lua_setfield(lua_ctx, -2, "getparticlecount");                   // -1
 
   lua_pushcfunction(lua_ctx, lua_interface_get_pixel_b2_ratio);  // +1
   lua_setfield(lua_ctx, -2, "getpixelb2ratio");                  // -1
@@ -1254,7 +1771,51 @@ TwoDimWorldScene::TwoDimWorldScene(SceneSystem *ctx)
   }
 }
 
-TwoDimWorldScene::~TwoDimWorldScene() { b2DestroyWorld(this->world_id); }
+TwoDimWorldScene::~TwoDimWorldScene() {
+  release_lua_handle(lua_handle);
+  b2DestroyWorld(this->world_id);
+}
+
+std::vector<TwoDimWorldScene::LuaHandleSlot>
+    TwoDimWorldScene::lua_handle_slots;
+
+TwoDimWorldScene *TwoDimWorldScene::from_lua_handle(int64_t handle) {
+  const uint64_t bits = static_cast<uint64_t>(handle);
+  const uint32_t slot_idx = static_cast<uint32_t>(bits & 0xFFFFFFFF);
+  if (slot_idx >= lua_handle_slots.size()) {
+    return nullptr;
+  }
+
+  const LuaHandleSlot &slot = lua_handle_slots[slot_idx];
+  if (slot.generation != static_cast<uint32_t>(bits >> 32)) {
+    return nullptr;
+  }
+  return slot.scene;
+}
+
+int64_t TwoDimWorldScene::acquire_lua_handle(TwoDimWorldScene *scene) {
+  size_t slot_idx = 0;
+  while (slot_idx < lua_handle_slots.size() &&
+         lua_handle_slots[slot_idx].scene != nullptr) {
+    ++slot_idx;
+  }
+  if (slot_idx == lua_handle_slots.size()) {
+    lua_handle_slots.push_back(LuaHandleSlot{nullptr, 0});
+  }
+
+  LuaHandleSlot &slot = lua_handle_slots[slot_idx];
+  slot.scene = scene;
+  return static_cast<int64_t>((static_cast<uint64_t>(slot.generation) << 32) |
+                              slot_idx);
+}
+
+void TwoDimWorldScene::release_lua_handle(int64_t handle) {
+  LuaHandleSlot &slot =
+      lua_handle_slots[static_cast<uint64_t>(handle) & 0xFFFFFFFF];
+  slot.scene = nullptr;
+  // Closures still holding "handle" no longer match.
+  ++slot.generation;
+}
 
 void TwoDimWorldScene::update(SceneSystem *ctx, float dt) {
   if (flags.test(0)) {
@@ -1264,6 +1825,31 @@ void TwoDimWorldScene::update(SceneSystem *ctx, float dt) {
   lua_State *lua_ctx =
       reinterpret_cast<lua_State *>(ctx->get_map_value("lua_state").value());
 
+  const auto input_start = std::chrono::steady_clock::now();
+
+  apply_pending_input_mode(lua_ctx);
+  if (flags.test(6)) {
+    prune_lua_body_cache(lua_ctx);
+  }
+
+  // Gather this frame's input, from the replay if one is running.
+  if (input_replayer.is_active()) {
+    if (input_replayer.next(&input_frame)) {
+      dt = input_frame.dt;
+    } else {
+      std::println(stdout, "Input replay finished.");
+      input_replayer.stop();
+      poll_input_frame(dt, flags.test(1), &input_frame);
+    }
+  } else {
+    poll_input_frame(dt, flags.test(1), &input_frame);
+  }
+  input_recorder.record(input_frame);
+  degrade_level = ctx->get_degrade_level();
+
+  const auto lua_start = std::chrono::steady_clock::now();
+  update_timings.input_us = elapsed_us(input_start, lua_start);
+
   int lua_ret_type = lua_getglobal(lua_ctx, "scene_2d");  // +1
 
   if (lua_ret_type == LUA_TTABLE) {
@@ -1276,9 +1862,8 @@ void TwoDimWorldScene::update(SceneSystem *ctx, float dt) {
     if (lua_ret_type != LUA_TFUNCTION) {
       lua_pop(lua_ctx, 1);  // -1
     } else {
-      int ret = GetKeyPressed();
-      while (ret != 0) {
-        lua_pushinteger(lua_ctx, ret);              // +1
+      for (int key : input_frame.keys) {
+        lua_pushinteger(lua_ctx, key);              // +1
         int lua_ret = lua_pcall(lua_ctx, 1, 0, 0);  // -2
         if (lua_ret != LUA_OK) {                    // error +1
           lua_error_text = std::format("{}", lua_tostring(lua_ctx, -1));
@@ -1287,21 +1872,20 @@ void TwoDimWorldScene::update(SceneSystem *ctx, float dt) {
           return;
         }
         lua_getfield(lua_ctx, -1, "key_pressed_callback");  // +1
-        ret = GetKeyPressed();
       }
       lua_pop(lua_ctx, 1);  // -1
     }
 
     // Gamepad events
-    if (flags.test(1)) {
+    if (input_frame.has_gamepad) {
       // Gamepad buttons
       lua_ret_type =
           lua_getfield(lua_ctx, -1, "gamepad_pressed_callback");  // +1
       if (lua_ret_type != LUA_TFUNCTION) {
         lua_pop(lua_ctx, 1);  // -1
       } else {
-        for (int idx = 0; idx < 32; ++idx) {
-          if (IsGamepadButtonPressed(0, idx)) {
+        for (int idx = 0; idx < INPUT_GAMEPAD_BUTTON_COUNT; ++idx) {
+          if ((input_frame.gamepad_buttons >> idx) & 1) {
             lua_pushinteger(lua_ctx, idx);              // +1
             int lua_ret = lua_pcall(lua_ctx, 1, 0, 0);  // -2
             if (lua_ret != LUA_OK) {                    // error +1
@@ -1312,18 +1896,17 @@ void TwoDimWorldScene::update(SceneSystem *ctx, float dt) {
             }
             lua_getfield(lua_ctx, -1, "gamepad_pressed_callback");  // +1
           }
-        }  // for idx 0..32
+        }  // for idx 0..INPUT_GAMEPAD_BUTTON_COUNT
         lua_pop(lua_ctx, 1);  // -1
       }
       // Gamepad axis
-      const int axis_count = GetGamepadAxisCount(0);
       lua_ret_type = lua_getfield(lua_ctx, -1, "gamepad_axis_callback");  // +1
       if (lua_ret_type != LUA_TFUNCTION) {
         lua_pop(lua_ctx, 1);  // -1
       } else {
-        for (int idx = 0; idx < axis_count; ++idx) {
-          lua_pushinteger(lua_ctx, idx);                            // +1
-          lua_pushnumber(lua_ctx, GetGamepadAxisMovement(0, idx));  // +1
+        for (size_t idx = 0; idx < input_frame.gamepad_axes.size(); ++idx) {
+          lua_pushinteger(lua_ctx, static_cast<lua_Integer>(idx));  // +1
+          lua_pushnumber(lua_ctx, input_frame.gamepad_axes[idx]);   // +1
           int lua_ret = lua_pcall(lua_ctx, 2, 0, 0);                // -3
           if (lua_ret != LUA_OK) {                                  // error +1
             lua_error_text = std::format("{}", lua_tostring(lua_ctx, -1));
@@ -1337,105 +1920,239 @@ void TwoDimWorldScene::update(SceneSystem *ctx, float dt) {
       }
     }
 
-    // scene_2d.update
-    int ret = lua_getfield(lua_ctx, -1, "update");  // +1
-    if (ret == LUA_TFUNCTION) {
-      lua_pushnumber(lua_ctx, dt);                          // +1
-      ret = lua_pcall(lua_ctx, 1, 0, 0);                    // -2
-      if (ret != LUA_OK) {                                  // +1
-        const char *error_str = lua_tostring(lua_ctx, -1);  // +0
-        if (error_str) {
-          lua_error_text = error_str;
-        } else {
-          lua_error_text = "WARNING: Unknown Lua error!";
+    // scene_2d.update, input callbacks above still run every update.
+    lua_update_dt += dt;
+    if (--lua_update_countdown <= 0) {
+      lua_update_countdown = is_sim_degraded(DegradeLevel::THROTTLED_LUA)
+                                 ? GOVERNOR_LUA_INTERVAL
+                                 : 1;
+      int ret = lua_getfield(lua_ctx, -1, "update");  // +1
+      if (ret == LUA_TFUNCTION) {
+        lua_pushnumber(lua_ctx, lua_update_dt);               // +1
+        ret = lua_pcall(lua_ctx, 1, 0, 0);                    // -2
+        if (ret != LUA_OK) {                                  // +1
+          const char *error_str = lua_tostring(lua_ctx, -1);  // +0
+          if (error_str) {
+            lua_error_text = error_str;
+          } else {
+            lua_error_text = "WARNING: Unknown Lua error!";
+          }
+          lua_pop(lua_ctx, 1);  // -1
+          flags.set(0);
         }
+      } else {
         lua_pop(lua_ctx, 1);  // -1
-        flags.set(0);
       }
-    } else {
-      lua_pop(lua_ctx, 1);  // -1
+      lua_update_dt = 0.0F;
     }
     lua_pop(lua_ctx, 1);  // -1
   } else {
     lua_pop(lua_ctx, 1);  // -1
   }
 
-  b2World_Step(world_id, dt, 4);
+  const auto physics_start = std::chrono::steady_clock::now();
+  update_timings.lua_us = elapsed_us(lua_start, physics_start);
+  update_timings.world_step_us = 0.0F;
+
+  if (!terrain.empty() && --terrain_refresh_countdown <= 0) {
+    refresh_terrain(dt * static_cast<float>(TERRAIN_REFRESH_INTERVAL));
+  }
+
+  apply_body_commands();
+
+  max_body_speed_sq = 0.0F;
+  const SimSettings &settings = ctx->get_sim_settings();
+  if (settings.min_substeps != settings_min_substeps ||
+      settings.max_substeps != settings_max_substeps) {
+    settings_min_substeps = settings.min_substeps;
+    settings_max_substeps = settings.max_substeps;
+    set_substep_bounds(settings_min_substeps, settings_max_substeps);
+  }
+  int steps_taken = 1;
+  float step_dt = dt;
+  if (settings.fixed_step_enabled && settings.fixed_step_rate > 0) {
+    step_dt = 1.0F / static_cast<float>(settings.fixed_step_rate);
+    step_accumulator += dt;
+
+    int steps = static_cast<int>(step_accumulator / step_dt);
+    if (steps > settings.max_catchup_steps) {
+      // Drop time that can't be caught up on, otherwise a long hitch causes
+      // ever-growing step counts in the following frames.
+      steps = settings.max_catchup_steps;
+      step_accumulator = step_dt * static_cast<float>(steps);
+    }
+
+    steps_taken = steps;
+    for (int idx = 0; idx < steps; ++idx) {
+      if (idx + 1 == steps) {
+        store_prev_transforms();
+      }
+      step_world(step_dt);
+      step_accumulator -= step_dt;
+    }
+
+    if (step_accumulator < 0.0F) {
+      step_accumulator = 0.0F;
+    }
+    interp_alpha = step_accumulator / step_dt;
+    flags.set(2);
+  } else {
+    step_accumulator = 0.0F;
+    interp_alpha = 1.0F;
+    flags.reset(2);
+    step_world(dt);
+  }
+
+  const auto events_start = std::chrono::steady_clock::now();
+  update_timings.physics_us = elapsed_us(physics_start, events_start);
+  // Without a step there are no speeds to go by, the update isn't calm.
+  if (steps_taken > 0) {
+    update_substep_count(dt);
+  }
+
+  deliver_contact_events(lua_ctx);
+
+  const auto particles_start = std::chrono::steady_clock::now();
+  update_timings.events_us = elapsed_us(events_start, particles_start);
+
+  particles.update(dt, b2World_GetGravity(world_id));
+
+  update_timings.particles_us =
+      elapsed_us(particles_start, std::chrono::steady_clock::now());
 }
 
 void TwoDimWorldScene::draw(SceneSystem *ctx) {
-  // Draw ground
-  DrawRectangle(PIXEL_B2UNIT_RATIO * (GROUND_X - GROUND_HW),
-                PIXEL_B2UNIT_RATIO * (GROUND_Y - GROUND_HH),
-                PIXEL_B2UNIT_RATIO * GROUND_HW * 2.0F,
-                PIXEL_B2UNIT_RATIO * GROUND_HH * 2.0F, DARKGREEN);
-
-  // Draw walls
-  DrawRectangle(PIXEL_B2UNIT_RATIO * (LWALL_X - WALL_HW),
-                PIXEL_B2UNIT_RATIO * (LWALL_Y - WALL_HH),
-                PIXEL_B2UNIT_RATIO * WALL_HW * 2.0F,
-                PIXEL_B2UNIT_RATIO * WALL_HH * 2.0F, BROWN);
-  DrawRectangle(PIXEL_B2UNIT_RATIO * (RWALL_X - WALL_HW),
-                PIXEL_B2UNIT_RATIO * (RWALL_Y - WALL_HH),
-                PIXEL_B2UNIT_RATIO * WALL_HW * 2.0F,
-                PIXEL_B2UNIT_RATIO * WALL_HH * 2.0F, BROWN);
-
-  // Draw ball
-  for (auto iter = ball_ids.begin(); iter != ball_ids.end(); ++iter) {
-    b2Vec2 pos = b2Body_GetPosition(iter->second.id);
-    DrawCircle(pos.x * PIXEL_B2UNIT_RATIO, pos.y * PIXEL_B2UNIT_RATIO,
-               BALL_R * PIXEL_B2UNIT_RATIO, iter->second.color);
-  }
-
-  // Draw octagon
-  Vector2 b_vertices[8];
-  for (auto iter = octagon_ids.begin(); iter != octagon_ids.end(); ++iter) {
-    // b2Vec2 octagon_pos = b2Body_GetPosition(iter->second.id);
-    // DrawCircle(octagon_pos.x * PIXEL_B2UNIT_RATIO, octagon_pos.y *
-    // PIXEL_B2UNIT_RATIO,
-    //            BALL_R * PIXEL_B2UNIT_RATIO, iter->second.color);
-    b2Transform b_tr = b2Body_GetTransform(iter->second.id);
-    for (int idx = 0; idx < 8; ++idx) {
-      b_vertices[7 - idx].x =
-          (b_tr.p.x + b_tr.q.c * cached_octagon_polygon->vertices[idx].x -
-           b_tr.q.s * cached_octagon_polygon->vertices[idx].y) *
-          PIXEL_B2UNIT_RATIO;
-      b_vertices[7 - idx].y =
-          (b_tr.p.y + b_tr.q.s * cached_octagon_polygon->vertices[idx].x +
-           b_tr.q.c * cached_octagon_polygon->vertices[idx].y) *
-          PIXEL_B2UNIT_RATIO;
+  BeginMode2D(camera);
+
+  if (flags.test(5)) {
+    terrain.draw(PIXEL_B2UNIT_RATIO, DARKGREEN);
+  } else {
+    // Draw ground
+    DrawRectangle(PIXEL_B2UNIT_RATIO * (GROUND_X - GROUND_HW),
+                  PIXEL_B2UNIT_RATIO * (GROUND_Y - GROUND_HH),
+                  PIXEL_B2UNIT_RATIO * GROUND_HW * 2.0F,
+                  PIXEL_B2UNIT_RATIO * GROUND_HH * 2.0F, DARKGREEN);
+
+    // Draw walls
+    const float wall_top = LWALL_Y + WALL_HH - wall_half_height * 2.0F;
+    DrawRectangle(PIXEL_B2UNIT_RATIO * (LWALL_X - WALL_HW),
+                  PIXEL_B2UNIT_RATIO * wall_top,
+                  PIXEL_B2UNIT_RATIO * WALL_HW * 2.0F,
+                  PIXEL_B2UNIT_RATIO * wall_half_height * 2.0F, BROWN);
+    DrawRectangle(PIXEL_B2UNIT_RATIO * (RWALL_X - WALL_HW),
+                  PIXEL_B2UNIT_RATIO * wall_top,
+                  PIXEL_B2UNIT_RATIO * WALL_HW * 2.0F,
+                  PIXEL_B2UNIT_RATIO * wall_half_height * 2.0F, BROWN);
+  }
+
+  // Interpolate from the previous fixed step towards the current one.
+  const DegradeLevel level = ctx->get_degrade_level();
+  const float alpha =
+      flags.test(2) && level < DegradeLevel::NO_INTERPOLATION ? interp_alpha
+                                                              : 1.0F;
+
+  collect_visible_bodies(ctx->get_sim_settings().cull_offscreen ||
+                         level >= DegradeLevel::CULLED_DRAW);
+
+  if (ctx->get_sim_settings().instanced_rendering &&
+      instanced_renderer->is_supported()) {
+    draw_bodies_instanced(alpha);
+  } else {
+    // Draw ball
+    const BodyRegistry::KindStore &balls = bodies.get_store(BodyKind::BALL);
+    for (uint32_t i : visible_indices[static_cast<size_t>(BodyKind::BALL)]) {
+      b2Vec2 pos =
+          b2Lerp(balls.prev_transforms[i].p, balls.transforms[i].p, alpha);
+      DrawCircle(pos.x * PIXEL_B2UNIT_RATIO, pos.y * PIXEL_B2UNIT_RATIO,
+                 BALL_R * PIXEL_B2UNIT_RATIO, balls.colors[i]);
+    }
+
+    // Draw octagon
+    const std::vector<uint32_t> &visible_octagons =
+        visible_indices[static_cast<size_t>(BodyKind::OCTAGON)];
+    if (!visible_octagons.empty()) {
+      const BodyRegistry::KindStore &octagons =
+          bodies.get_store(BodyKind::OCTAGON);
+      // Reversed so the fan winds the way raylib expects.
+      b2Vec2 b_local[8];
+      for (int idx = 0; idx < 8; ++idx) {
+        b_local[7 - idx] =
+            prototypes[static_cast<size_t>(BodyKind::OCTAGON)]
+                .polygon.vertices[idx];
+      }
+      fill_interpolated_transforms(octagons, visible_octagons, alpha);
+      vertex_buffer.resize(visible_octagons.size() * 8);
+      transform_vertices(transform_buffer.data(), transform_buffer.size(),
+                         b_local, 8, PIXEL_B2UNIT_RATIO, vertex_buffer.data());
+      for (size_t i = 0; i < visible_octagons.size(); ++i) {
+        DrawTriangleFan(&vertex_buffer[i * 8], 8,
+                        octagons.colors[visible_octagons[i]]);
+      }
+    }
+
+    // Draw trapezoid
+    // b2AABB t_aabb = b2Body_ComputeAABB(trapezoid_id);
+    // DrawRectangleLines(
+    //    PIXEL_B2UNIT_RATIO * t_aabb.lowerBound.x,
+    //    PIXEL_B2UNIT_RATIO * t_aabb.lowerBound.y,
+    //    PIXEL_B2UNIT_RATIO * (t_aabb.upperBound.x - t_aabb.lowerBound.x),
+    //    PIXEL_B2UNIT_RATIO * (t_aabb.upperBound.y - t_aabb.lowerBound.y),
+    //    BLUE);
+    const std::vector<uint32_t> &visible_trapezoids =
+        visible_indices[static_cast<size_t>(BodyKind::TRAPEZOID)];
+    if (!visible_trapezoids.empty()) {
+      const BodyRegistry::KindStore &trapezoids =
+          bodies.get_store(BodyKind::TRAPEZOID);
+      fill_interpolated_transforms(trapezoids, visible_trapezoids, alpha);
+      vertex_buffer.resize(visible_trapezoids.size() * 4);
+      transform_vertices(transform_buffer.data(), transform_buffer.size(),
+                         prototypes[static_cast<size_t>(BodyKind::TRAPEZOID)]
+                             .polygon.vertices,
+                         4, PIXEL_B2UNIT_RATIO, vertex_buffer.data());
+      for (size_t i = 0; i < visible_trapezoids.size(); ++i) {
+        const Vector2 *t_vertices = &vertex_buffer[i * 4];
+        const Color color = trapezoids.colors[visible_trapezoids[i]];
+        DrawTriangle(t_vertices[2], t_vertices[1], t_vertices[0], color);
+        DrawTriangle(t_vertices[2], t_vertices[0], t_vertices[3], color);
+      }
     }
+  }
 
-    DrawTriangleFan(b_vertices, 8, iter->second.color);
-  }
-
-  // Draw trapezoid
-  // b2AABB t_aabb = b2Body_ComputeAABB(trapezoid_id);
-  // DrawRectangleLines(
-  //    PIXEL_B2UNIT_RATIO * t_aabb.lowerBound.x,
-  //    PIXEL_B2UNIT_RATIO * t_aabb.lowerBound.y,
-  //    PIXEL_B2UNIT_RATIO * (t_aabb.upperBound.x - t_aabb.lowerBound.x),
-  //    PIXEL_B2UNIT_RATIO * (t_aabb.upperBound.y - t_aabb.lowerBound.y), BLUE);
-  Vector2 t_vertices[4];
-  for (auto iter = trapezoid_ids.begin(); iter != trapezoid_ids.end(); ++iter) {
-    b2Transform t_tr = b2Body_GetTransform(iter->second.id);
-    for (int idx = 0; idx < 4; ++idx) {
-      t_vertices[idx].x =
-          (t_tr.p.x + t_tr.q.c * cached_trapezoid_polygon->vertices[idx].x -
-           t_tr.q.s * cached_trapezoid_polygon->vertices[idx].y) *
-          PIXEL_B2UNIT_RATIO;
-      t_vertices[idx].y =
-          (t_tr.p.y + t_tr.q.s * cached_trapezoid_polygon->vertices[idx].x +
-           t_tr.q.c * cached_trapezoid_polygon->vertices[idx].y) *
-          PIXEL_B2UNIT_RATIO;
+  // Draw particles
+  if (particles.size() != 0) {
+    b2AABB view = get_visible_aabb();
+    view.lowerBound =
+        b2Sub(view.lowerBound, b2Vec2{PARTICLE_HALF_SIZE, PARTICLE_HALF_SIZE});
+    view.upperBound =
+        b2Add(view.upperBound, b2Vec2{PARTICLE_HALF_SIZE, PARTICLE_HALF_SIZE});
+    instance_buffer.clear();
+    particles.fill_instances(view, PIXEL_B2UNIT_RATIO, &instance_buffer);
+    if (ctx->get_sim_settings().instanced_rendering &&
+        instanced_renderer->is_supported()) {
+      instanced_renderer->draw(PARTICLE_MESH_IDX, instance_buffer.data(),
+                               instance_buffer.size());
+    } else {
+      // raylib merges these into as few batches as its buffer allows.
+      const float size = PARTICLE_HALF_SIZE * 2.0F * PIXEL_B2UNIT_RATIO;
+      const float half_size = PARTICLE_HALF_SIZE * PIXEL_B2UNIT_RATIO;
+      for (const ShapeInstance &instance : instance_buffer) {
+        DrawRectangleV(Vector2{instance.x - half_size, instance.y - half_size},
+                       Vector2{size, size}, instance.color);
+      }
     }
+  }
 
-    DrawTriangle(t_vertices[2], t_vertices[1], t_vertices[0],
-                 iter->second.color);
-    DrawTriangle(t_vertices[2], t_vertices[0], t_vertices[3],
-                 iter->second.color);
+  // Draw sensors
+  for (const auto &[id, sensor] : sensors) {
+    DrawRectangleLines(
+        PIXEL_B2UNIT_RATIO * (sensor.pos.x - sensor.half_extents.x),
+        PIXEL_B2UNIT_RATIO * (sensor.pos.y - sensor.half_extents.y),
+        PIXEL_B2UNIT_RATIO * sensor.half_extents.x * 2.0F,
+        PIXEL_B2UNIT_RATIO * sensor.half_extents.y * 2.0F, YELLOW);
   }
 
+  EndMode2D();
+
   if (!lua_error_text.empty()) {
     DrawText(lua_error_text.c_str(), 0, 0, 10, WHITE);
   }
@@ -1446,236 +2163,1384 @@ void TwoDimWorldScene::draw_rlimgui(SceneSystem *ctx) {}
 bool TwoDimWorldScene::allow_draw_below(SceneSystem *ctx) { return true; }
 
 uint32_t TwoDimWorldScene::create_ball() {
-  // Create dynamic body ball
-  b2BodyDef ball_body = b2DefaultBodyDef();
-  ball_body.type = b2_dynamicBody;
-  ball_body.position = b2Vec2{1.5F, -get_rand() * 5.0F};
-  std::println("Created ball at {}, {}", ball_body.position.x,
-               ball_body.position.y);
-  b2BodyId ball_id = b2CreateBody(this->world_id, &ball_body);
-  b2Body_SetLinearVelocity(ball_id, {-1.0F, 0.0F});
-
-  b2Circle circle{{0.0F, 0.0F}, BALL_R};
-  b2ShapeDef b_shape_def = b2DefaultShapeDef();
-  b_shape_def.density = 1.0F;
-  b_shape_def.material.friction = 0.3F;
-  b_shape_def.material.restitution = 0.4F;
-  b_shape_def.material.rollingResistance = 0.15F;
-  b2CreateCircleShape(ball_id, &b_shape_def, &circle);
-
-  while (ball_ids.contains(ball_idx_counter)) {
-    ++ball_idx_counter;
-  }
-  ball_ids.insert({ball_idx_counter++, {ball_id, get_random_color()}});
-  return ball_idx_counter - 1;
+  return create_body(BodyKind::BALL);
 }
 
 bool TwoDimWorldScene::destroy_ball(uint32_t idx) {
-  if (auto iter = ball_ids.find(idx); iter != ball_ids.end()) {
-    b2DestroyBody(iter->second.id);
-    ball_ids.erase(iter);
+  return destroy_body(BodyKind::BALL, idx);
+}
+
+b2Vec2 TwoDimWorldScene::get_ball_pos(uint32_t idx) const {
+  return get_body_pos(BodyKind::BALL, idx);
+}
+
+void TwoDimWorldScene::set_ball_pos(uint32_t idx, float x, float y) {
+  set_body_pos(BodyKind::BALL, idx, x, y);
+}
+
+b2Vec2 TwoDimWorldScene::get_ball_vel(uint32_t idx) const {
+  return get_body_vel(BodyKind::BALL, idx);
+}
+
+void TwoDimWorldScene::apply_ball_impulse(uint32_t idx, float x, float y) {
+  apply_body_impulse(BodyKind::BALL, idx, x, y);
+}
+
+void TwoDimWorldScene::set_ball_color(uint32_t idx, Color color) {
+  set_body_color(BodyKind::BALL, idx, color);
+}
+
+uint32_t TwoDimWorldScene::create_octagon() {
+  return create_body(BodyKind::OCTAGON);
+}
+
+bool TwoDimWorldScene::destroy_octagon(uint32_t idx) {
+  return destroy_body(BodyKind::OCTAGON, idx);
+}
+
+b2Vec2 TwoDimWorldScene::get_octagon_pos(uint32_t idx) const {
+  return get_body_pos(BodyKind::OCTAGON, idx);
+}
+
+void TwoDimWorldScene::set_octagon_pos(uint32_t idx, float x, float y) {
+  set_body_pos(BodyKind::OCTAGON, idx, x, y);
+}
+
+b2Vec2 TwoDimWorldScene::get_octagon_vel(uint32_t idx) const {
+  return get_body_vel(BodyKind::OCTAGON, idx);
+}
+
+void TwoDimWorldScene::apply_octagon_impulse(uint32_t idx, float x, float y) {
+  apply_body_impulse(BodyKind::OCTAGON, idx, x, y);
+}
+
+void TwoDimWorldScene::set_octagon_color(uint32_t idx, Color color) {
+  set_body_color(BodyKind::OCTAGON, idx, color);
+}
+
+uint32_t TwoDimWorldScene::create_trapezoid() {
+  return create_body(BodyKind::TRAPEZOID);
+}
+
+bool TwoDimWorldScene::destroy_trapezoid(uint32_t idx) {
+  return destroy_body(BodyKind::TRAPEZOID, idx);
+}
+
+b2Vec2 TwoDimWorldScene::get_trapezoid_pos(uint32_t idx) const {
+  return get_body_pos(BodyKind::TRAPEZOID, idx);
+}
+
+void TwoDimWorldScene::set_trapezoid_pos(uint32_t idx, float x, float y) {
+  set_body_pos(BodyKind::TRAPEZOID, idx, x, y);
+}
+
+b2Vec2 TwoDimWorldScene::get_trapezoid_vel(uint32_t idx) const {
+  return get_body_vel(BodyKind::TRAPEZOID, idx);
+}
+
+void TwoDimWorldScene::apply_trapezoid_impulse(uint32_t idx, float x, float y) {
+  apply_body_impulse(BodyKind::TRAPEZOID, idx, x, y);
+}
+
+void TwoDimWorldScene::set_trapezoid_color(uint32_t idx, Color color) {
+  set_body_color(BodyKind::TRAPEZOID, idx, color);
+}
+
+uint32_t TwoDimWorldScene::spawn_body(BodyKind kind, b2Vec2 pos, b2Vec2 vel,
+                                      std::optional<Color> color) {
+  b2BodyDef body_def = prototypes[static_cast<size_t>(kind)].body_def;
+  body_def.position = pos;
+  body_def.linearVelocity = vel;
+  b2BodyId body_id = acquire_body(kind, body_def);
+
+  uint32_t handle = register_body(kind, body_id);
+  if (handle != BODY_HANDLE_INVALID) {
+    if (color.has_value()) {
+      set_body_color(kind, handle, color.value());
+    }
+    BodyPoolStats &stats = body_pool_stats[static_cast<size_t>(kind)];
+    stats.peak_live =
+        std::max(stats.peak_live, bodies.get_store(kind).body_ids.size());
+  }
+  return handle;
+}
+
+void TwoDimWorldScene::spawn_bodies(BodyKind kind, int count,
+                                    const SpawnParams &params,
+                                    std::vector<uint32_t> *ids_out) {
+  const b2Vec2 vel = params.velocity.value_or(
+      prototypes[static_cast<size_t>(kind)].velocity);
+  for (int idx = 0; idx < count; ++idx) {
+    b2Vec2 pos = params.position.has_value() ? params.position.value()
+                                             : get_default_spawn_pos(kind);
+    pos = b2MulAdd(pos, static_cast<float>(idx), params.spacing);
+
+    uint32_t handle = spawn_body(kind, pos, vel, params.color);
+    if (handle == BODY_HANDLE_INVALID) {
+      break;
+    }
+    if (ids_out) {
+      ids_out->push_back(handle);
+    }
+  }
+}
+
+b2Vec2 TwoDimWorldScene::get_default_spawn_pos(BodyKind kind) {
+  return b2Vec2{prototypes[static_cast<size_t>(kind)].spawn_x,
+                -get_rand() * 5.0F};
+}
+
+uint32_t TwoDimWorldScene::create_body(BodyKind kind) {
+  return spawn_body(kind, get_default_spawn_pos(kind),
+                    prototypes[static_cast<size_t>(kind)].velocity,
+                    std::nullopt);
+}
+
+bool TwoDimWorldScene::destroy_body(BodyKind kind, uint32_t idx) {
+  if (auto dense_idx = bodies.find(idx, kind); dense_idx.has_value()) {
+    flags.set(6);
+    release_body(kind, bodies.get_store(kind).body_ids[dense_idx.value()]);
+    bodies.erase(idx, kind);
     return true;
   }
 
   return false;
 }
 
-b2Vec2 TwoDimWorldScene::get_ball_pos(uint32_t idx) const {
-  if (auto iter = ball_ids.find(idx); iter != ball_ids.end()) {
-    return b2Body_GetPosition(iter->second.id);
+b2Vec2 TwoDimWorldScene::get_body_pos(BodyKind kind, uint32_t idx) const {
+  if (auto dense_idx = bodies.find(idx, kind); dense_idx.has_value()) {
+    return bodies.get_store(kind).transforms[dense_idx.value()].p;
   }
 
   return {0, 0};
 }
 
-void TwoDimWorldScene::set_ball_pos(uint32_t idx, float x, float y) {
-  if (auto iter = ball_ids.find(idx); iter != ball_ids.end()) {
-    b2Rot rot = b2Body_GetRotation(iter->second.id);
-    b2Body_SetTransform(iter->second.id, b2Vec2{x, y}, rot);
+void TwoDimWorldScene::set_body_pos(BodyKind kind, uint32_t idx, float x,
+                                    float y) {
+  if (auto dense_idx = bodies.find(idx, kind); dense_idx.has_value()) {
+    BodyRegistry::KindStore &store = bodies.get_store(kind);
+    b2BodyId body_id = store.body_ids[dense_idx.value()];
+    b2Rot rot = store.transforms[dense_idx.value()].q;
+    b2Body_SetTransform(body_id, b2Vec2{x, y}, rot);
+    // Teleport, don't interpolate from the old position.
+    store.transforms[dense_idx.value()] = b2Transform{b2Vec2{x, y}, rot};
+    store.prev_transforms[dense_idx.value()] = b2Transform{b2Vec2{x, y}, rot};
   }
 }
 
-b2Vec2 TwoDimWorldScene::get_ball_vel(uint32_t idx) const {
-  if (auto iter = ball_ids.find(idx); iter != ball_ids.end()) {
-    return b2Body_GetLinearVelocity(iter->second.id);
+b2Vec2 TwoDimWorldScene::get_body_vel(BodyKind kind, uint32_t idx) const {
+  if (auto dense_idx = bodies.find(idx, kind); dense_idx.has_value()) {
+    return bodies.get_store(kind).velocities[dense_idx.value()];
   }
 
   return {0, 0};
 }
 
-void TwoDimWorldScene::apply_ball_impulse(uint32_t idx, float x, float y) {
-  if (auto iter = ball_ids.find(idx); iter != ball_ids.end()) {
-    b2Body_ApplyLinearImpulseToCenter(iter->second.id, b2Vec2{x, y}, true);
+void TwoDimWorldScene::apply_body_impulse(BodyKind kind, uint32_t idx, float x,
+                                          float y) {
+  if (auto dense_idx = bodies.find(idx, kind); dense_idx.has_value()) {
+    BodyRegistry::KindStore &store = bodies.get_store(kind);
+    b2BodyId body_id = store.body_ids[dense_idx.value()];
+    b2Body_ApplyLinearImpulseToCenter(body_id, b2Vec2{x, y}, true);
+    // Scripts may read the velocity back before the next step.
+    store.velocities[dense_idx.value()] = b2Body_GetLinearVelocity(body_id);
   }
 }
 
-void TwoDimWorldScene::set_ball_color(uint32_t idx, Color color) {
-  if (auto iter = ball_ids.find(idx); iter != ball_ids.end()) {
-    iter->second.color = color;
+void TwoDimWorldScene::set_body_color(BodyKind kind, uint32_t idx,
+                                      Color color) {
+  if (auto dense_idx = bodies.find(idx, kind); dense_idx.has_value()) {
+    bodies.get_store(kind).colors[dense_idx.value()] = color;
   }
 }
 
-uint32_t TwoDimWorldScene::create_octagon() {
-  // Create dynamic body octagon
-  b2BodyDef octagon_body = b2DefaultBodyDef();
-  octagon_body.type = b2_dynamicBody;
-  octagon_body.position = b2Vec2{1.7F, -get_rand() * 5.0F};
-  std::println("Created octagon at {}, {}", octagon_body.position.x,
-               octagon_body.position.y);
-  b2BodyId octagon_id = b2CreateBody(this->world_id, &octagon_body);
-  b2Body_SetLinearVelocity(octagon_id, {-1.0F, 0.0F});
+void TwoDimWorldScene::queue_body_pos(BodyKind kind, uint32_t idx, float x,
+                                      float y) {
+  body_commands.push_back(
+      BodyCommand{idx, kind, BodyCommandType::SET_POS, b2Vec2{x, y}});
+}
+
+void TwoDimWorldScene::queue_body_impulse(BodyKind kind, uint32_t idx,
+                                          float x, float y) {
+  body_commands.push_back(
+      BodyCommand{idx, kind, BodyCommandType::IMPULSE, b2Vec2{x, y}});
+}
+
+float TwoDimWorldScene::get_rand() { return real_dist(rand_e); }
+
+uint32_t TwoDimWorldScene::register_body(BodyKind kind, b2BodyId body_id) {
+  uint32_t handle = bodies.insert(kind, body_id, get_random_color(),
+                                  b2Body_GetTransform(body_id),
+                                  b2Body_GetLinearVelocity(body_id));
+  if (handle == BODY_HANDLE_INVALID) {
+    std::println(stdout, "WARNING: Body limit reached!");
+    b2DestroyBody(body_id);
+    return handle;
+  }
+
+  b2Body_SetUserData(body_id, body_handle_to_user_data(handle));
+  return handle;
+}
+
+void TwoDimWorldScene::create_walls() {
+  // The walls' bottom stays on the ground whatever their height.
+  const float offset_y = WALL_HH - wall_half_height;
+  b2ShapeDef wall_shape_def = b2DefaultShapeDef();
+  wall_shape_def.material.restitution = 0.8F;
+  const b2Polygon wall_box = b2MakeBox(WALL_HW, wall_half_height);
+
+  b2BodyDef wall_body_def = b2DefaultBodyDef();
+  wall_body_def.position = b2Vec2{LWALL_X, LWALL_Y + offset_y};
+  this->left_wall_id = b2CreateBody(this->world_id, &wall_body_def);
+  b2CreatePolygonShape(this->left_wall_id, &wall_shape_def, &wall_box);
+
+  wall_body_def.position = b2Vec2{RWALL_X, RWALL_Y + offset_y};
+  this->right_wall_id = b2CreateBody(this->world_id, &wall_body_def);
+  b2CreatePolygonShape(this->right_wall_id, &wall_shape_def, &wall_box);
+}
+
+b2BodyId TwoDimWorldScene::create_prototype_body(BodyKind kind,
+                                                 const b2BodyDef &body_def) {
+  const BodyPrototype &proto = prototypes[static_cast<size_t>(kind)];
+  b2BodyId body_id = b2CreateBody(this->world_id, &body_def);
+  if (proto.is_circle) {
+    b2CreateCircleShape(body_id, &proto.shape_def, &proto.circle);
+  } else {
+    b2CreatePolygonShape(body_id, &proto.shape_def, &proto.polygon);
+  }
+  return body_id;
+}
+
+b2BodyId TwoDimWorldScene::acquire_body(BodyKind kind,
+                                        const b2BodyDef &body_def) {
+  std::vector<b2BodyId> &pool = body_pools[static_cast<size_t>(kind)];
+  BodyPoolStats &stats = body_pool_stats[static_cast<size_t>(kind)];
+  if (pool.empty()) {
+    ++stats.created;
+    return create_prototype_body(kind, body_def);
+  }
+
+  b2BodyId body_id = pool.back();
+  pool.pop_back();
+  stats.pooled =
+      pool.size() + released_bodies[static_cast<size_t>(kind)].size();
+  ++stats.reused;
+
+  // Disabled bodies keep no velocity state, so set it once enabled.
+  b2Body_SetTransform(body_id, body_def.position, body_def.rotation);
+  b2Body_Enable(body_id);
+  b2Body_SetLinearVelocity(body_id, body_def.linearVelocity);
+  b2Body_SetAngularVelocity(body_id, body_def.angularVelocity);
+  if (!body_def.isAwake) {
+    b2Body_SetAwake(body_id, false);
+  }
+  return body_id;
+}
+
+void TwoDimWorldScene::release_body(BodyKind kind, b2BodyId body_id) {
+  std::vector<b2BodyId> &released = released_bodies[static_cast<size_t>(kind)];
+  const size_t pooled =
+      body_pools[static_cast<size_t>(kind)].size() + released.size();
+  if (pooled >= body_pool_size) {
+    b2DestroyBody(body_id);
+    return;
+  }
+
+  // Events raised while disabling must not resolve to the old handle.
+  b2Body_SetUserData(body_id, nullptr);
+  b2Body_Disable(body_id);
+  released.push_back(body_id);
+
+  body_pool_stats[static_cast<size_t>(kind)].pooled = pooled + 1;
+}
+
+void TwoDimWorldScene::pool_released_bodies() {
+  for (int kind = 0; kind < BODY_KIND_COUNT; ++kind) {
+    body_pools[kind].insert(body_pools[kind].end(),
+                            released_bodies[kind].begin(),
+                            released_bodies[kind].end());
+    released_bodies[kind].clear();
+  }
+}
 
+void TwoDimWorldScene::init_prototypes() {
+  b2BodyDef body_def = b2DefaultBodyDef();
+  body_def.type = b2_dynamicBody;
+
+  b2ShapeDef shape_def = b2DefaultShapeDef();
+  shape_def.density = 1.0F;
+  shape_def.material.friction = 0.3F;
+  shape_def.material.restitution = 0.4F;
+  shape_def.material.rollingResistance = 0.15F;
+  // Box2D only reports sensor overlaps for shapes that opt in.
+  shape_def.enableSensorEvents = true;
+
+  BodyPrototype &ball = prototypes[static_cast<size_t>(BodyKind::BALL)];
+  ball.body_def = body_def;
+  ball.shape_def = shape_def;
+  ball.circle = b2Circle{{0.0F, 0.0F}, BALL_R};
+  ball.is_circle = true;
+  ball.spawn_x = 1.5F;
+  ball.velocity = b2Vec2{-1.0F, 0.0F};
+
+  BodyPrototype &octagon = prototypes[static_cast<size_t>(BodyKind::OCTAGON)];
   b2Hull b_hull = b2ComputeHull(B_POINTS, 8);
-  b2Polygon b_polygon = b2MakePolygon(&b_hull, 0.0F);
-  b2ShapeDef b_shape_def = b2DefaultShapeDef();
-  b_shape_def.density = 1.0F;
-  b_shape_def.material.friction = 0.3F;
-  b_shape_def.material.restitution = 0.4F;
-  b_shape_def.material.rollingResistance = 0.15F;
-  b2CreatePolygonShape(octagon_id, &b_shape_def, &b_polygon);
+  octagon.body_def = body_def;
+  octagon.shape_def = shape_def;
+  octagon.polygon = b2MakePolygon(&b_hull, 0.0F);
+  octagon.is_circle = false;
+  octagon.spawn_x = 1.7F;
+  octagon.velocity = b2Vec2{-1.0F, 0.0F};
+
+  BodyPrototype &trapezoid =
+      prototypes[static_cast<size_t>(BodyKind::TRAPEZOID)];
+  b2Hull t_hull = b2ComputeHull(T_POINTS, 4);
+  trapezoid.body_def = body_def;
+  trapezoid.shape_def = b2DefaultShapeDef();
+  trapezoid.shape_def.density = 1.0F;
+  trapezoid.shape_def.material.friction = 0.6F;
+  trapezoid.shape_def.enableSensorEvents = true;
+  trapezoid.polygon = b2MakePolygon(&t_hull, T_RADIUS);
+  trapezoid.is_circle = false;
+  trapezoid.spawn_x = 3.0F;
+  trapezoid.velocity = b2Vec2{0.0F, 0.0F};
+}
+
+void TwoDimWorldScene::init_instanced_meshes() {
+  // Meshes are added in BodyKind order so the mesh index is the kind.
+  std::vector<Vector2> vertices;
+
+  const float ball_r = BALL_R * PIXEL_B2UNIT_RATIO;
+  for (int idx = 0; idx < INSTANCED_CIRCLE_SEGMENTS; ++idx) {
+    const float angle_a =
+        2.0F * PI * static_cast<float>(idx) / INSTANCED_CIRCLE_SEGMENTS;
+    const float angle_b =
+        2.0F * PI * static_cast<float>(idx + 1) / INSTANCED_CIRCLE_SEGMENTS;
+    vertices.push_back(Vector2{0.0F, 0.0F});
+    vertices.push_back(
+        Vector2{std::cos(angle_a) * ball_r, std::sin(angle_a) * ball_r});
+    vertices.push_back(
+        Vector2{std::cos(angle_b) * ball_r, std::sin(angle_b) * ball_r});
+  }
+  instanced_renderer->add_mesh(vertices);
+
+  for (BodyKind kind : {BodyKind::OCTAGON, BodyKind::TRAPEZOID}) {
+    const b2Polygon &polygon = prototypes[static_cast<size_t>(kind)].polygon;
+    vertices.clear();
+    for (int idx = 1; idx + 1 < polygon.count; ++idx) {
+      vertices.push_back(Vector2{polygon.vertices[0].x * PIXEL_B2UNIT_RATIO,
+                                 polygon.vertices[0].y * PIXEL_B2UNIT_RATIO});
+      vertices.push_back(
+          Vector2{polygon.vertices[idx].x * PIXEL_B2UNIT_RATIO,
+                  polygon.vertices[idx].y * PIXEL_B2UNIT_RATIO});
+      vertices.push_back(
+          Vector2{polygon.vertices[idx + 1].x * PIXEL_B2UNIT_RATIO,
+                  polygon.vertices[idx + 1].y * PIXEL_B2UNIT_RATIO});
+    }
+    instanced_renderer->add_mesh(vertices);
+  }
+
+  // PARTICLE_MESH_IDX, a square wound like the polygons above.
+  const float half_size = PARTICLE_HALF_SIZE * PIXEL_B2UNIT_RATIO;
+  instanced_renderer->add_mesh(std::vector<Vector2>{
+      Vector2{-half_size, -half_size}, Vector2{half_size, -half_size},
+      Vector2{half_size, half_size}, Vector2{-half_size, -half_size},
+      Vector2{half_size, half_size}, Vector2{-half_size, half_size}});
+}
 
-  if (!cached_octagon_polygon.has_value()) {
-    b2ShapeId b_shape;
-    b2Body_GetShapes(octagon_id, &b_shape, 1);
-    cached_octagon_polygon = b2Shape_GetPolygon(b_shape);
+void TwoDimWorldScene::draw_bodies_instanced(float alpha) {
+  for (int kind = 0; kind < BODY_KIND_COUNT; ++kind) {
+    const BodyRegistry::KindStore &store =
+        bodies.get_store(static_cast<BodyKind>(kind));
+    const std::vector<uint32_t> &visible = visible_indices[kind];
+    instance_buffer.resize(visible.size());
+    for (size_t i = 0; i < visible.size(); ++i) {
+      const uint32_t idx = visible[i];
+      b2Transform tr = interpolate_transform(store.prev_transforms[idx],
+                                             store.transforms[idx], alpha);
+      instance_buffer[i] = ShapeInstance{tr.p.x * PIXEL_B2UNIT_RATIO,
+                                         tr.p.y * PIXEL_B2UNIT_RATIO, tr.q.c,
+                                         tr.q.s, store.colors[idx]};
+    }
+    instanced_renderer->draw(static_cast<uint32_t>(kind),
+                             instance_buffer.data(), instance_buffer.size());
   }
+}
 
-  while (octagon_ids.contains(octagon_idx_counter)) {
-    ++octagon_idx_counter;
+void TwoDimWorldScene::fill_interpolated_transforms(
+    const BodyRegistry::KindStore &store, const std::vector<uint32_t> &indices,
+    float alpha) {
+  transform_buffer.resize(indices.size());
+  for (size_t i = 0; i < indices.size(); ++i) {
+    transform_buffer[i] = interpolate_transform(
+        store.prev_transforms[indices[i]], store.transforms[indices[i]], alpha);
   }
-  octagon_ids.insert({octagon_idx_counter++, {octagon_id, get_random_color()}});
-  return octagon_idx_counter - 1;
 }
 
-bool TwoDimWorldScene::destroy_octagon(uint32_t idx) {
-  if (auto iter = octagon_ids.find(idx); iter != octagon_ids.end()) {
-    b2DestroyBody(iter->second.id);
-    octagon_ids.erase(iter);
-    return true;
+void TwoDimWorldScene::collect_visible_bodies(bool cull) {
+  for (int kind = 0; kind < BODY_KIND_COUNT; ++kind) {
+    visible_indices[kind].clear();
   }
 
-  return false;
+  if (!cull) {
+    for (int kind = 0; kind < BODY_KIND_COUNT; ++kind) {
+      const size_t size = bodies.get_store(static_cast<BodyKind>(kind)).size();
+      visible_indices[kind].resize(size);
+      std::iota(visible_indices[kind].begin(), visible_indices[kind].end(), 0);
+    }
+    return;
+  }
+
+  b2AABB view = get_visible_aabb();
+  // Bodies are drawn interpolated from where they were, allow some slack.
+  view.lowerBound = b2Sub(view.lowerBound, b2Vec2{CULL_MARGIN, CULL_MARGIN});
+  view.upperBound = b2Add(view.upperBound, b2Vec2{CULL_MARGIN, CULL_MARGIN});
+  b2World_OverlapAABB(world_id, view, b2DefaultQueryFilter(),
+                      TwoDimWorldScene::cull_query_callback, this);
+
+  // Query order follows Box2D's tree, keep draw order stable instead.
+  for (int kind = 0; kind < BODY_KIND_COUNT; ++kind) {
+    std::sort(visible_indices[kind].begin(), visible_indices[kind].end());
+  }
 }
 
-b2Vec2 TwoDimWorldScene::get_octagon_pos(uint32_t idx) const {
-  if (auto iter = octagon_ids.find(idx); iter != octagon_ids.end()) {
-    return b2Body_GetPosition(iter->second.id);
+bool TwoDimWorldScene::cull_query_callback(b2ShapeId shape_id, void *ctx) {
+  TwoDimWorldScene *scene = reinterpret_cast<TwoDimWorldScene *>(ctx);
+  std::optional<uint32_t> handle =
+      body_handle_from_user_data(b2Body_GetUserData(b2Shape_GetBody(shape_id)));
+  if (handle.has_value()) {
+    if (std::optional<BodyKind> kind = scene->bodies.get_kind(handle.value());
+        kind.has_value()) {
+      scene->visible_indices[static_cast<size_t>(kind.value())].push_back(
+          scene->bodies.find(handle.value(), kind.value()).value());
+    }
   }
+  return true;
+}
 
-  return {0, 0};
+b2AABB TwoDimWorldScene::get_visible_aabb() const {
+  const Vector2 top_left = GetScreenToWorld2D(Vector2{0.0F, 0.0F}, camera);
+  const Vector2 bottom_right = GetScreenToWorld2D(
+      Vector2{static_cast<float>(GetScreenWidth()),
+              static_cast<float>(GetScreenHeight())},
+      camera);
+  return b2AABB{b2Vec2{top_left.x / PIXEL_B2UNIT_RATIO,
+                       top_left.y / PIXEL_B2UNIT_RATIO},
+                b2Vec2{bottom_right.x / PIXEL_B2UNIT_RATIO,
+                       bottom_right.y / PIXEL_B2UNIT_RATIO}};
 }
 
-void TwoDimWorldScene::set_octagon_pos(uint32_t idx, float x, float y) {
-  if (auto iter = octagon_ids.find(idx); iter != octagon_ids.end()) {
-    b2Rot rot = b2Body_GetRotation(iter->second.id);
-    b2Body_SetTransform(iter->second.id, b2Vec2{x, y}, rot);
+void TwoDimWorldScene::set_camera(float x, float y, float zoom) {
+  camera.target = Vector2{x * PIXEL_B2UNIT_RATIO, y * PIXEL_B2UNIT_RATIO};
+  camera.zoom = zoom;
+}
+
+void TwoDimWorldScene::store_prev_transforms() {
+  for (int kind = 0; kind < BODY_KIND_COUNT; ++kind) {
+    BodyRegistry::KindStore &store =
+        bodies.get_store(static_cast<BodyKind>(kind));
+    store.prev_transforms = store.transforms;
   }
 }
 
-b2Vec2 TwoDimWorldScene::get_octagon_vel(uint32_t idx) const {
-  if (auto iter = octagon_ids.find(idx); iter != octagon_ids.end()) {
-    return b2Body_GetLinearVelocity(iter->second.id);
+void TwoDimWorldScene::reset_lua_body_cache() {
+  lua_newtable(lua_state);                                     // +1
+  lua_setfield(lua_state, LUA_REGISTRYINDEX, LUA_BODY_CACHE);  // -1
+}
+
+void TwoDimWorldScene::prune_lua_body_cache(lua_State *lua_ctx) {
+  flags.reset(6);
+
+  lua_getfield(lua_ctx, LUA_REGISTRYINDEX, LUA_BODY_CACHE);  // +1
+  lua_pushnil(lua_ctx);                                      // +1
+  while (lua_next(lua_ctx, -2) != 0) {                       // -1, +2
+    lua_pop(lua_ctx, 1);  // -1
+    const uint32_t handle = static_cast<uint32_t>(lua_tointeger(lua_ctx, -1));
+    if (!bodies.get_kind(handle).has_value()) {
+      // Clearing the current key is allowed while traversing.
+      lua_pushvalue(lua_ctx, -1);  // +1
+      lua_pushnil(lua_ctx);        // +1
+      lua_rawset(lua_ctx, -4);     // -2
+    }
   }
+  lua_pop(lua_ctx, 1);  // -1
+}
 
-  return {0, 0};
+void TwoDimWorldScene::apply_body_commands() {
+  // Sorting walks one kind's store at a time and groups each body's
+  // commands, stable so the last queued position wins. Teleports and impulses
+  // commute, so a body gets at most one of each however much was queued.
+  std::stable_sort(body_commands.begin(), body_commands.end(),
+                   [](const BodyCommand &a, const BodyCommand &b) {
+                     return a.kind != b.kind ? a.kind < b.kind
+                                             : a.handle < b.handle;
+                   });
+
+  size_t idx = 0;
+  while (idx < body_commands.size()) {
+    const BodyKind kind = body_commands[idx].kind;
+    const uint32_t handle = body_commands[idx].handle;
+    std::optional<b2Vec2> pos;
+    std::optional<b2Vec2> impulse;
+    for (; idx < body_commands.size() && body_commands[idx].kind == kind &&
+           body_commands[idx].handle == handle;
+         ++idx) {
+      const BodyCommand &command = body_commands[idx];
+      if (command.type == BodyCommandType::SET_POS) {
+        pos = command.value;
+      } else {
+        impulse = b2Add(impulse.value_or(b2Vec2{0.0F, 0.0F}), command.value);
+      }
+    }
+
+    // Bodies destroyed since are skipped by the lookups.
+    if (pos.has_value()) {
+      set_body_pos(kind, handle, pos->x, pos->y);
+    }
+    if (impulse.has_value()) {
+      apply_body_impulse(kind, handle, impulse->x, impulse->y);
+    }
+  }
+
+  body_commands.clear();
 }
 
-void TwoDimWorldScene::apply_octagon_impulse(uint32_t idx, float x, float y) {
-  if (auto iter = octagon_ids.find(idx); iter != octagon_ids.end()) {
-    b2Body_ApplyLinearImpulseToCenter(iter->second.id, b2Vec2{x, y}, true);
+void TwoDimWorldScene::step_world(float step_dt) {
+  task_pool->begin_step();
+  const auto step_start = std::chrono::steady_clock::now();
+  b2World_Step(world_id, step_dt, substep_count);
+  update_timings.world_step_us +=
+      elapsed_us(step_start, std::chrono::steady_clock::now());
+
+  // Only bodies that moved this step get an event, sleeping bodies cost
+  // nothing here.
+  b2BodyEvents events = b2World_GetBodyEvents(world_id);
+  for (int idx = 0; idx < events.moveCount; ++idx) {
+    const b2BodyMoveEvent &event = events.moveEvents[idx];
+    std::optional<uint32_t> handle =
+        body_handle_from_user_data(event.userData);
+    if (!handle.has_value()) {
+      continue;
+    }
+    std::optional<BodyKind> kind = bodies.get_kind(handle.value());
+    if (!kind.has_value()) {
+      continue;
+    }
+    uint32_t dense_idx = bodies.find(handle.value(), kind.value()).value();
+    BodyRegistry::KindStore &store = bodies.get_store(kind.value());
+    store.transforms[dense_idx] = event.transform;
+    store.velocities[dense_idx] =
+        event.fellAsleep ? b2Vec2{0.0F, 0.0F}
+                         : b2Body_GetLinearVelocity(event.bodyId);
+    max_body_speed_sq = std::max(max_body_speed_sq,
+                                 b2LengthSquared(store.velocities[dense_idx]));
+
+    const bool fast = b2LengthSquared(store.velocities[dense_idx]) *
+                          step_dt * step_dt >
+                      BULLET_MIN_TRAVEL * BULLET_MIN_TRAVEL;
+    if (fast != b2Body_IsBullet(event.bodyId)) {
+      b2Body_SetBullet(event.bodyId, fast);
+    }
   }
+
+  collect_contact_events();
+  // End events of bodies released before this step were just collected.
+  pool_released_bodies();
 }
 
-void TwoDimWorldScene::set_octagon_color(uint32_t idx, Color color) {
-  if (auto iter = octagon_ids.find(idx); iter != octagon_ids.end()) {
-    iter->second.color = color;
+void TwoDimWorldScene::collect_contact_events() {
+  b2ContactEvents contacts = b2World_GetContactEvents(world_id);
+  touching_contacts += contacts.beginCount - contacts.endCount;
+  for (int idx = 0; idx < contacts.beginCount; ++idx) {
+    const b2ContactBeginTouchEvent &event = contacts.beginEvents[idx];
+    contact_begin_events.emplace_back(get_shape_body_id(event.shapeIdA),
+                                      get_shape_body_id(event.shapeIdB));
+  }
+  for (int idx = 0; idx < contacts.endCount; ++idx) {
+    const b2ContactEndTouchEvent &event = contacts.endEvents[idx];
+    contact_end_events.emplace_back(get_shape_body_id(event.shapeIdA),
+                                    get_shape_body_id(event.shapeIdB));
+  }
+
+  b2SensorEvents sensor_events = b2World_GetSensorEvents(world_id);
+  for (int idx = 0; idx < sensor_events.beginCount; ++idx) {
+    const b2SensorBeginTouchEvent &event = sensor_events.beginEvents[idx];
+    sensor_begin_events.emplace_back(get_shape_sensor_id(event.sensorShapeId),
+                                     get_shape_body_id(event.visitorShapeId));
+  }
+  for (int idx = 0; idx < sensor_events.endCount; ++idx) {
+    const b2SensorEndTouchEvent &event = sensor_events.endEvents[idx];
+    sensor_end_events.emplace_back(get_shape_sensor_id(event.sensorShapeId),
+                                   get_shape_body_id(event.visitorShapeId));
   }
 }
 
-uint32_t TwoDimWorldScene::create_trapezoid() {
-  // Create dynamic body trapezoid
-  b2BodyDef t_body = b2DefaultBodyDef();
-  t_body.type = b2_dynamicBody;
-  t_body.position = b2Vec2{3.0F, -get_rand() * 5.0F};
-  std::println("Created trapezoid at {}, {}", t_body.position.x,
-               t_body.position.y);
-  b2BodyId trapezoid_id = b2CreateBody(this->world_id, &t_body);
+void TwoDimWorldScene::apply_pending_input_mode(lua_State *lua_ctx) {
+  uint32_t seed;
+  std::vector<uint8_t> snapshot;
+  if (flags.test(3)) {
+    flags.reset(3);
+    seed = rng_seed;
+    save_snapshot(&snapshot);
+  } else if (flags.test(4)) {
+    flags.reset(4);
+    seed = input_replayer.get_seed();
+    snapshot = input_replayer.get_snapshot();
+  } else {
+    return;
+  }
 
-  b2Hull t_hull = b2ComputeHull(T_POINTS, 4);
-  b2Polygon t_polygon = b2MakePolygon(&t_hull, T_RADIUS);
-  b2ShapeDef t_shape_def = b2DefaultShapeDef();
-  t_shape_def.density = 1.0F;
-  t_shape_def.material.friction = 0.6F;
-  b2CreatePolygonShape(trapezoid_id, &t_shape_def, &t_polygon);
+  // Recording also rebuilds the world from its snapshot, so the recorded run
+  // and its replays start with bodies created in the same order.
+  if (!restore_snapshot(snapshot)) {
+    std::println(stdout, "WARNING: Failed to start input recording/replay!");
+    input_replayer.stop();
+    return;
+  }
+  set_seed(seed);
+  // Substeps and the Lua update throttle carried over from before would make
+  // the first updates differ. Lua globals are not part of the snapshot, so a
+  // replay only matches when the script holds the same state as when the
+  // recording started.
+  substep_count = std::clamp(SUBSTEP_BASELINE, min_substeps, max_substeps);
+  lua_update_countdown = 0;
+  lua_update_dt = 0.0F;
+
+  // Lua scripts using "math.random" get the same sequence too.
+  if (lua_getglobal(lua_ctx, "math") == LUA_TTABLE) {                // +1
+    if (lua_getfield(lua_ctx, -1, "randomseed") == LUA_TFUNCTION) {  // +1
+      lua_pushinteger(lua_ctx, seed);                                // +1
+      if (lua_pcall(lua_ctx, 1, 0, 0) != LUA_OK) {  // -2, error +1
+        lua_pop(lua_ctx, 1);                        // -1
+      }
+    } else {
+      lua_pop(lua_ctx, 1);  // -1
+    }
+  }
+  lua_pop(lua_ctx, 1);  // -1
+
+  if (!input_replayer.is_active()) {
+    input_recorder.begin(seed, std::move(snapshot));
+  }
+}
+
+bool TwoDimWorldScene::is_sim_degraded(DegradeLevel level) const {
+  return degrade_level >= level && !input_recorder.is_active() &&
+         !input_replayer.is_active();
+}
+
+void TwoDimWorldScene::update_substep_count(float dt) {
+  int wanted = min_substeps;
+  if (max_body_speed_sq >= SUBSTEP_CALM_SPEED * SUBSTEP_CALM_SPEED) {
+    wanted = SUBSTEP_BASELINE;
+
+    // Piles need more substeps to stay stable. Only live bodies count, Box2D
+    // also counts static, sensor and pooled bodies.
+    const size_t live_bodies = bodies.size();
+    if (live_bodies > 0 &&
+        static_cast<float>(touching_contacts) >=
+            static_cast<float>(live_bodies) * SUBSTEP_PILE_CONTACT_RATIO) {
+      wanted += SUBSTEP_PILE_EXTRA;
+    }
+  }
+  if (is_sim_degraded(DegradeLevel::FEWER_SUBSTEPS)) {
+    wanted = (wanted + 1) / 2;
+  }
+  wanted = std::clamp(wanted, min_substeps, max_substeps);
+
+  // Wall-clock time differs between runs, recordings and replays only adapt
+  // to the simulation itself so they stay in sync.
+  const bool over_budget =
+      !input_recorder.is_active() && !input_replayer.is_active() &&
+      update_timings.physics_us > dt * 1000000.0F * SUBSTEP_BUDGET_FRACTION;
+  if (over_budget) {
+    substep_count = std::min(wanted, substep_count - 1);
+  } else if (wanted >= substep_count) {
+    // Raise at once, stability problems show up immediately.
+    substep_count = wanted;
+  } else {
+    // Lower one at a time so brief lulls don't cause oscillation.
+    --substep_count;
+  }
+  substep_count = std::clamp(substep_count, min_substeps, max_substeps);
+}
+
+void TwoDimWorldScene::refresh_terrain(float lookahead) {
+  terrain_refresh_countdown = TERRAIN_REFRESH_INTERVAL;
+  terrain_keys.clear();
+  terrain_body_ranges.clear();
+
+  // Chunks around the view, capped for far zoomed out cameras.
+  const b2AABB view = get_visible_aabb();
+  const int32_t view_min_x =
+      terrain.get_chunk_coord(view.lowerBound.x) - TERRAIN_CHUNK_MARGIN;
+  const int32_t view_min_y =
+      terrain.get_chunk_coord(view.lowerBound.y) - TERRAIN_CHUNK_MARGIN;
+  const int32_t view_max_x =
+      std::min(terrain.get_chunk_coord(view.upperBound.x) +
+                   TERRAIN_CHUNK_MARGIN,
+               view_min_x + TERRAIN_MAX_VIEW_CHUNKS);
+  const int32_t view_max_y =
+      std::min(terrain.get_chunk_coord(view.upperBound.y) +
+                   TERRAIN_CHUNK_MARGIN,
+               view_min_y + TERRAIN_MAX_VIEW_CHUNKS);
+  for (int32_t x = view_min_x; x <= view_max_x; ++x) {
+    for (int32_t y = view_min_y; y <= view_max_y; ++y) {
+      terrain_keys.push_back(TerrainStreamer::make_chunk_key(x, y));
+    }
+  }
+
+  // Chunks from every body to where its velocity takes it before the next
+  // refresh, so fast bodies don't reach unloaded chunks. Bodies cluster, so
+  // dedupe their ranges before adding neighbours.
+  for (int kind = 0; kind < BODY_KIND_COUNT; ++kind) {
+    const BodyRegistry::KindStore &store =
+        bodies.get_store(static_cast<BodyKind>(kind));
+    for (size_t idx = 0; idx < store.size(); ++idx) {
+      const b2Vec2 pos = store.transforms[idx].p;
+      const b2Vec2 ahead = b2MulAdd(pos, lookahead, store.velocities[idx]);
+      const int32_t start_x = terrain.get_chunk_coord(pos.x);
+      const int32_t start_y = terrain.get_chunk_coord(pos.y);
+      const int32_t end_x =
+          std::clamp(terrain.get_chunk_coord(ahead.x),
+                     start_x - TERRAIN_MAX_BODY_CHUNKS,
+                     start_x + TERRAIN_MAX_BODY_CHUNKS);
+      const int32_t end_y =
+          std::clamp(terrain.get_chunk_coord(ahead.y),
+                     start_y - TERRAIN_MAX_BODY_CHUNKS,
+                     start_y + TERRAIN_MAX_BODY_CHUNKS);
+      terrain_body_ranges.push_back(
+          {std::min(start_x, end_x), std::min(start_y, end_y),
+           std::max(start_x, end_x), std::max(start_y, end_y)});
+    }
+  }
+  std::sort(terrain_body_ranges.begin(), terrain_body_ranges.end());
+  terrain_body_ranges.erase(
+      std::unique(terrain_body_ranges.begin(), terrain_body_ranges.end()),
+      terrain_body_ranges.end());
+  for (const auto &[min_x, min_y, max_x, max_y] : terrain_body_ranges) {
+    for (int32_t x = min_x - TERRAIN_CHUNK_MARGIN;
+         x <= max_x + TERRAIN_CHUNK_MARGIN; ++x) {
+      for (int32_t y = min_y - TERRAIN_CHUNK_MARGIN;
+           y <= max_y + TERRAIN_CHUNK_MARGIN; ++y) {
+        terrain_keys.push_back(TerrainStreamer::make_chunk_key(x, y));
+      }
+    }
+  }
+
+  std::sort(terrain_keys.begin(), terrain_keys.end());
+  terrain_keys.erase(std::unique(terrain_keys.begin(), terrain_keys.end()),
+                     terrain_keys.end());
+  terrain.update(world_id, terrain_keys);
+}
 
-  if (!cached_trapezoid_polygon.has_value()) {
-    b2ShapeId t_shape;
-    b2Body_GetShapes(trapezoid_id, &t_shape, 1);
-    cached_trapezoid_polygon = b2Shape_GetPolygon(t_shape);
+void TwoDimWorldScene::deliver_contact_events(lua_State *lua_ctx) {
+  if (contact_begin_events.empty() && contact_end_events.empty() &&
+      sensor_begin_events.empty() && sensor_end_events.empty()) {
+    return;
   }
 
-  while (trapezoid_ids.contains(trapezoid_idx_counter)) {
-    ++trapezoid_idx_counter;
+  if (!flags.test(0)) {
+    int lua_ret_type = lua_getglobal(lua_ctx, "scene_2d");  // +1
+    if (lua_ret_type == LUA_TTABLE) {
+      lua_ret_type = lua_getfield(lua_ctx, -1, "contact_callback");  // +1
+      if (lua_ret_type == LUA_TFUNCTION) {
+        // The events table is kept in "scene_2d.contact_events" and reused.
+        lua_ret_type = lua_getfield(lua_ctx, -2, "contact_events");  // +1
+        if (lua_ret_type != LUA_TTABLE) {
+          lua_pop(lua_ctx, 1);                          // -1
+          lua_newtable(lua_ctx);                        // +1
+          lua_pushvalue(lua_ctx, -1);                   // +1
+          lua_setfield(lua_ctx, -4, "contact_events");  // -1
+        }
+        lua_interface_helper_write_event_pairs(lua_ctx, -1, "begin",
+                                               contact_begin_events);
+        lua_interface_helper_write_event_pairs(lua_ctx, -1, "end",
+                                               contact_end_events);
+        lua_interface_helper_write_event_pairs(lua_ctx, -1, "sensor_begin",
+                                               sensor_begin_events);
+        lua_interface_helper_write_event_pairs(lua_ctx, -1, "sensor_end",
+                                               sensor_end_events);
+
+        int ret = lua_pcall(lua_ctx, 1, 0, 0);                // -2
+        if (ret != LUA_OK) {                                  // +1
+          const char *error_str = lua_tostring(lua_ctx, -1);  // +0
+          if (error_str) {
+            lua_error_text = error_str;
+          } else {
+            lua_error_text = "WARNING: Unknown Lua error!";
+          }
+          lua_pop(lua_ctx, 1);  // -1
+          flags.set(0);
+        }
+      } else {
+        lua_pop(lua_ctx, 1);  // -1
+      }
+    }
+    lua_pop(lua_ctx, 1);  // -1
   }
-  trapezoid_ids.insert(
-      {trapezoid_idx_counter++, {trapezoid_id, get_random_color()}});
 
-  return trapezoid_idx_counter - 1;
+  contact_begin_events.clear();
+  contact_end_events.clear();
+  sensor_begin_events.clear();
+  sensor_end_events.clear();
 }
 
-bool TwoDimWorldScene::destroy_trapezoid(uint32_t idx) {
-  if (auto iter = trapezoid_ids.find(idx); iter != trapezoid_ids.end()) {
-    b2DestroyBody(iter->second.id);
-    trapezoid_ids.erase(iter);
+int64_t TwoDimWorldScene::get_shape_body_id(b2ShapeId shape_id) const {
+  // Shapes of destroyed bodies still show up in end events.
+  if (!b2Shape_IsValid(shape_id)) {
+    return -1;
+  }
+  std::optional<uint32_t> handle =
+      body_handle_from_user_data(b2Body_GetUserData(b2Shape_GetBody(shape_id)));
+  return handle.has_value() ? static_cast<int64_t>(handle.value()) : -1;
+}
+
+int64_t TwoDimWorldScene::get_shape_sensor_id(b2ShapeId shape_id) const {
+  if (!b2Shape_IsValid(shape_id)) {
+    return -1;
+  }
+  std::optional<uint32_t> id =
+      body_handle_from_user_data(b2Shape_GetUserData(shape_id));
+  return id.has_value() ? static_cast<int64_t>(id.value()) : -1;
+}
+
+const std::vector<uint32_t> &TwoDimWorldScene::query_aabb(b2AABB aabb) {
+  query_results.clear();
+  query_aabb_bounds = aabb;
+  b2World_OverlapAABB(world_id, aabb, b2DefaultQueryFilter(),
+                      TwoDimWorldScene::query_aabb_callback, this);
+  return query_results;
+}
+
+const std::vector<uint32_t> &TwoDimWorldScene::query_circle(b2Vec2 center,
+                                                            float radius) {
+  query_results.clear();
+  b2ShapeProxy proxy = b2MakeProxy(&center, 1, radius);
+  b2World_OverlapShape(world_id, &proxy, b2DefaultQueryFilter(),
+                       TwoDimWorldScene::query_shape_callback, this);
+  return query_results;
+}
+
+const std::vector<uint32_t> &TwoDimWorldScene::cast_ray(b2Vec2 origin,
+                                                        b2Vec2 translation) {
+  query_results.clear();
+  ray_hits.clear();
+  b2World_CastRay(world_id, origin, translation, b2DefaultQueryFilter(),
+                  TwoDimWorldScene::cast_ray_callback, this);
+
+  // Box2D reports hits in no particular order.
+  std::sort(ray_hits.begin(), ray_hits.end());
+  for (const auto &[fraction, handle] : ray_hits) {
+    query_results.push_back(handle);
+  }
+  return query_results;
+}
+
+bool TwoDimWorldScene::query_aabb_callback(b2ShapeId shape_id, void *ctx) {
+  TwoDimWorldScene *scene = reinterpret_cast<TwoDimWorldScene *>(ctx);
+  // The broadphase reports enlarged AABBs, check the tight one.
+  if (!b2AABB_Overlaps(b2Shape_GetAABB(shape_id), scene->query_aabb_bounds)) {
     return true;
   }
+  return query_shape_callback(shape_id, ctx);
+}
 
-  return false;
+bool TwoDimWorldScene::query_shape_callback(b2ShapeId shape_id, void *ctx) {
+  TwoDimWorldScene *scene = reinterpret_cast<TwoDimWorldScene *>(ctx);
+  int64_t id = scene->get_shape_body_id(shape_id);
+  if (id >= 0) {
+    scene->query_results.push_back(static_cast<uint32_t>(id));
+  }
+  return true;
 }
 
-b2Vec2 TwoDimWorldScene::get_trapezoid_pos(uint32_t idx) const {
-  if (auto iter = trapezoid_ids.find(idx); iter != trapezoid_ids.end()) {
-    return b2Body_GetPosition(iter->second.id);
+float TwoDimWorldScene::cast_ray_callback(b2ShapeId shape_id, b2Vec2 point,
+                                          b2Vec2 normal, float fraction,
+                                          void *ctx) {
+  TwoDimWorldScene *scene = reinterpret_cast<TwoDimWorldScene *>(ctx);
+  int64_t id = scene->get_shape_body_id(shape_id);
+  if (id >= 0) {
+    scene->ray_hits.emplace_back(fraction, static_cast<uint32_t>(id));
   }
+  // Don't clip the ray, every body along it is wanted.
+  return 1.0F;
+}
 
-  return {0, 0};
+void TwoDimWorldScene::save_snapshot(std::vector<uint8_t> *out) const {
+  out->clear();
+  ByteWriter writer(out);
+  writer.write(SNAPSHOT_MAGIC);
+  writer.write(SNAPSHOT_VERSION);
+
+  const std::vector<uint16_t> generations = bodies.get_slot_generations();
+  writer.write(static_cast<uint32_t>(generations.size()));
+  for (uint16_t generation : generations) {
+    writer.write(generation);
+  }
+  const std::deque<uint32_t> &free_slots = bodies.get_free_slots();
+  writer.write(static_cast<uint32_t>(free_slots.size()));
+  for (uint32_t slot_idx : free_slots) {
+    writer.write(slot_idx);
+  }
+
+  writer.write(static_cast<uint32_t>(bodies.size()));
+  for (int kind = 0; kind < BODY_KIND_COUNT; ++kind) {
+    const BodyRegistry::KindStore &store =
+        bodies.get_store(static_cast<BodyKind>(kind));
+    for (size_t i = 0; i < store.size(); ++i) {
+      const b2BodyId body_id = store.body_ids[i];
+      const b2Vec2 vel = b2Body_GetLinearVelocity(body_id);
+      writer.write(store.handles[i]);
+      writer.write(static_cast<uint8_t>(kind));
+      writer.write(store.transforms[i].p.x);
+      writer.write(store.transforms[i].p.y);
+      writer.write(store.transforms[i].q.c);
+      writer.write(store.transforms[i].q.s);
+      writer.write(vel.x);
+      writer.write(vel.y);
+      writer.write(b2Body_GetAngularVelocity(body_id));
+      writer.write(static_cast<uint8_t>(b2Body_IsAwake(body_id) ? 1 : 0));
+      writer.write(store.colors[i]);
+    }
+  }
+
+  writer.write(sensor_idx_counter);
+  writer.write(static_cast<uint32_t>(sensors.size()));
+  for (const auto &[id, sensor] : sensors) {
+    writer.write(id);
+    writer.write(sensor.pos.x);
+    writer.write(sensor.pos.y);
+    writer.write(sensor.half_extents.x);
+    writer.write(sensor.half_extents.y);
+  }
 }
 
-void TwoDimWorldScene::set_trapezoid_pos(uint32_t idx, float x, float y) {
-  if (auto iter = trapezoid_ids.find(idx); iter != trapezoid_ids.end()) {
-    b2Rot rot = b2Body_GetRotation(iter->second.id);
-    b2Body_SetTransform(iter->second.id, b2Vec2{x, y}, rot);
+bool TwoDimWorldScene::restore_snapshot(const std::vector<uint8_t> &data) {
+  struct SnapshotBody {
+    uint32_t handle;
+    uint8_t kind;
+    b2Transform transform;
+    b2Vec2 vel;
+    float angular_vel;
+    uint8_t awake;
+    Color color;
+  };
+
+  // Parse everything first so a bad snapshot leaves the world untouched.
+  ByteReader reader(data.data(), data.size());
+  uint32_t magic = 0;
+  uint16_t version = 0;
+  reader.read(&magic);
+  reader.read(&version);
+  if (!reader.is_ok() || magic != SNAPSHOT_MAGIC ||
+      version != SNAPSHOT_VERSION) {
+    std::println(stdout, "WARNING: Not a compatible snapshot!");
+    return false;
+  }
+
+  uint32_t count = 0;
+  reader.read(&count);
+  std::vector<uint16_t> generations;
+  for (uint32_t idx = 0; reader.is_ok() && idx < count; ++idx) {
+    uint16_t generation = 0;
+    reader.read(&generation);
+    generations.push_back(generation);
+  }
+  reader.read(&count);
+  std::deque<uint32_t> free_slots;
+  for (uint32_t idx = 0; reader.is_ok() && idx < count; ++idx) {
+    uint32_t slot_idx = 0;
+    reader.read(&slot_idx);
+    if (slot_idx >= generations.size()) {
+      std::println(stdout, "WARNING: Snapshot has an invalid free slot!");
+      return false;
+    }
+    free_slots.push_back(slot_idx);
+  }
+  reader.read(&count);
+  std::vector<SnapshotBody> snapshot_bodies;
+  for (uint32_t idx = 0; reader.is_ok() && idx < count; ++idx) {
+    SnapshotBody body;
+    reader.read(&body.handle);
+    reader.read(&body.kind);
+    reader.read(&body.transform.p.x);
+    reader.read(&body.transform.p.y);
+    reader.read(&body.transform.q.c);
+    reader.read(&body.transform.q.s);
+    reader.read(&body.vel.x);
+    reader.read(&body.vel.y);
+    reader.read(&body.angular_vel);
+    reader.read(&body.awake);
+    reader.read(&body.color);
+    if (body.kind >= BODY_KIND_COUNT) {
+      std::println(stdout, "WARNING: Snapshot has an invalid body kind!");
+      return false;
+    }
+    if (reader.is_ok() &&
+        (!b2IsValidVec2(body.transform.p) ||
+         !b2IsValidRotation(body.transform.q) || !b2IsValidVec2(body.vel) ||
+         !b2IsValidFloat(body.angular_vel))) {
+      std::println(stdout, "WARNING: Snapshot has an invalid body state!");
+      return false;
+    }
+    snapshot_bodies.push_back(body);
+  }
+  uint32_t new_sensor_counter = 0;
+  reader.read(&new_sensor_counter);
+  reader.read(&count);
+  std::vector<std::pair<uint32_t, SensorInfo> > snapshot_sensors;
+  for (uint32_t idx = 0; reader.is_ok() && idx < count; ++idx) {
+    uint32_t id = 0;
+    SensorInfo sensor{b2_nullBodyId, {0.0F, 0.0F}, {0.0F, 0.0F}};
+    reader.read(&id);
+    reader.read(&sensor.pos.x);
+    reader.read(&sensor.pos.y);
+    reader.read(&sensor.half_extents.x);
+    reader.read(&sensor.half_extents.y);
+    snapshot_sensors.emplace_back(id, sensor);
+  }
+  // Sensor ids must be unique and below the counter so later "createsensor"
+  // calls don't collide, and their boxes must be valid.
+  std::sort(snapshot_sensors.begin(), snapshot_sensors.end(),
+            [](const auto &a, const auto &b) { return a.first < b.first; });
+  for (size_t idx = 0; reader.is_ok() && idx < snapshot_sensors.size();
+       ++idx) {
+    const auto &[id, sensor] = snapshot_sensors[idx];
+    if ((idx > 0 && snapshot_sensors[idx - 1].first == id) ||
+        id >= new_sensor_counter || !b2IsValidVec2(sensor.pos) ||
+        !b2IsValidVec2(sensor.half_extents) || sensor.half_extents.x <= 0.0F ||
+        sensor.half_extents.y <= 0.0F) {
+      std::println(stdout, "WARNING: Snapshot has an invalid sensor!");
+      return false;
+    }
+  }
+  if (!reader.is_ok() || !reader.at_end()) {
+    std::println(stdout, "WARNING: Snapshot is truncated or corrupt!");
+    return false;
+  }
+
+  // Every slot must be either free, retired at the last generation or hold
+  // one body under the slot's generation, or a later insert could hand out
+  // a live slot.
+  bool slots_ok = generations.size() <= BODY_REGISTRY_CAPACITY;
+  std::vector<uint8_t> slot_used(generations.size(), 0);
+  for (uint16_t generation : generations) {
+    slots_ok = slots_ok && generation <= BODY_HANDLE_GENERATION_MASK;
+  }
+  for (uint32_t slot_idx : free_slots) {
+    slots_ok = slots_ok && slot_used[slot_idx] == 0 &&
+               generations[slot_idx] != BODY_HANDLE_GENERATION_MASK;
+    slot_used[slot_idx] = 1;
+  }
+  for (const SnapshotBody &body : snapshot_bodies) {
+    const uint32_t slot_idx = body.handle & BODY_HANDLE_INDEX_MASK;
+    slots_ok = slots_ok && slot_idx < generations.size() &&
+               slot_used[slot_idx] == 0 &&
+               generations[slot_idx] == body.handle >> BODY_HANDLE_INDEX_BITS;
+    if (!slots_ok) {
+      break;
+    }
+    slot_used[slot_idx] = 1;
+  }
+  for (size_t slot_idx = 0; slots_ok && slot_idx < generations.size();
+       ++slot_idx) {
+    slots_ok = slot_used[slot_idx] == 1 ||
+               generations[slot_idx] == BODY_HANDLE_GENERATION_MASK;
+  }
+  if (!slots_ok) {
+    std::println(stdout, "WARNING: Snapshot slots don't match its bodies!");
+    return false;
+  }
+
+  // Replace the world's dynamic state, keeping the replaced bodies pooled
+  // for the snapshot's bodies and later spawns.
+  for (int kind = 0; kind < BODY_KIND_COUNT; ++kind) {
+    const BodyKind body_kind = static_cast<BodyKind>(kind);
+    for (b2BodyId body_id : bodies.get_store(body_kind).body_ids) {
+      release_body(body_kind, body_id);
+    }
   }
+  for (const auto &[id, sensor] : sensors) {
+    b2DestroyBody(sensor.body_id);
+  }
+  sensors.clear();
+
+  bodies.restore_slots(generations, free_slots);
+  for (const SnapshotBody &body : snapshot_bodies) {
+    const BodyKind kind = static_cast<BodyKind>(body.kind);
+
+    b2BodyDef body_def = prototypes[body.kind].body_def;
+    body_def.position = body.transform.p;
+    body_def.rotation = body.transform.q;
+    body_def.linearVelocity = body.vel;
+    body_def.angularVelocity = body.angular_vel;
+    body_def.isAwake = body.awake != 0;
+    b2BodyId body_id = acquire_body(kind, body_def);
+
+    if (!bodies.insert_at(body.handle, kind, body_id, body.color,
+                          body.transform, body.vel)) {
+      std::println(stdout, "WARNING: Snapshot body {} conflicts, skipped!",
+                   body.handle);
+      release_body(kind, body_id);
+      continue;
+    }
+    b2Body_SetUserData(body_id, body_handle_to_user_data(body.handle));
+  }
+  for (int kind = 0; kind < BODY_KIND_COUNT; ++kind) {
+    body_pool_stats[kind].peak_live =
+        std::max(body_pool_stats[kind].peak_live,
+                 bodies.get_store(static_cast<BodyKind>(kind)).body_ids.size());
+  }
+
+  for (const auto &[id, sensor] : snapshot_sensors) {
+    create_sensor_with_id(id, sensor.pos.x, sensor.pos.y,
+                          sensor.half_extents.x, sensor.half_extents.y);
+  }
+  sensor_idx_counter = new_sensor_counter;
+
+  // Nothing to interpolate from, draw the restored transforms as they are.
+  store_prev_transforms();
+  step_accumulator = 0.0F;
+  interp_alpha = 1.0F;
+  terrain_refresh_countdown = 0;
+  body_commands.clear();
+  reset_lua_body_cache();
+  flags.reset(6);
+  contact_begin_events.clear();
+  contact_end_events.clear();
+  sensor_begin_events.clear();
+  sensor_end_events.clear();
+
+  return true;
 }
 
-b2Vec2 TwoDimWorldScene::get_trapezoid_vel(uint32_t idx) const {
-  if (auto iter = trapezoid_ids.find(idx); iter != trapezoid_ids.end()) {
-    return b2Body_GetLinearVelocity(iter->second.id);
+bool TwoDimWorldScene::save_snapshot_file(const std::string &path) const {
+  std::vector<uint8_t> data;
+  save_snapshot(&data);
+  return write_bytes_to_file(path, data);
+}
+
+bool TwoDimWorldScene::load_snapshot_file(const std::string &path) {
+  std::vector<uint8_t> data;
+  if (!read_bytes_from_file(path, &data)) {
+    return false;
   }
+  return restore_snapshot(data);
+}
 
-  return {0, 0};
+const UpdateTimings &TwoDimWorldScene::get_update_timings() const {
+  return update_timings;
 }
 
-void TwoDimWorldScene::apply_trapezoid_impulse(uint32_t idx, float x, float y) {
-  if (auto iter = trapezoid_ids.find(idx); iter != trapezoid_ids.end()) {
-    b2Body_ApplyLinearImpulseToCenter(iter->second.id, b2Vec2{x, y}, true);
+size_t TwoDimWorldScene::get_body_count() const { return bodies.size(); }
+
+bool TwoDimWorldScene::has_body(BodyKind kind, uint32_t idx) const {
+  return bodies.find(idx, kind).has_value();
+}
+
+std::optional<BodyKind> TwoDimWorldScene::get_body_kind(uint32_t idx) const {
+  return bodies.get_kind(idx);
+}
+
+const BodyRegistry::KindStore &TwoDimWorldScene::get_body_store(
+    BodyKind kind) const {
+  return bodies.get_store(kind);
+}
+
+const BodyPoolStats &TwoDimWorldScene::get_body_pool_stats(
+    BodyKind kind) const {
+  return body_pool_stats[static_cast<size_t>(kind)];
+}
+
+bool TwoDimWorldScene::load_terrain(const std::string &path) {
+  if (!terrain.load(path)) {
+    return false;
   }
+
+  // The terrain replaces the built-in ground and walls.
+  if (!flags.test(5)) {
+    b2DestroyBody(ground_id);
+    b2DestroyBody(left_wall_id);
+    b2DestroyBody(right_wall_id);
+    flags.set(5);
+  }
+
+  // Create nearby chunks now so bodies don't fall through for a frame. The
+  // next update knows its dt and extends them along body velocities.
+  refresh_terrain(0.0F);
+  terrain_refresh_countdown = 0;
+  return true;
 }
 
-void TwoDimWorldScene::set_trapezoid_color(uint32_t idx, Color color) {
-  if (auto iter = trapezoid_ids.find(idx); iter != trapezoid_ids.end()) {
-    iter->second.color = color;
+void TwoDimWorldScene::set_wall_height(float height) {
+  if (flags.test(5)) {
+    return;
   }
+  b2DestroyBody(left_wall_id);
+  b2DestroyBody(right_wall_id);
+  wall_half_height = std::max(height, WALL_HH * 2.0F) / 2.0F;
+  create_walls();
 }
 
-float TwoDimWorldScene::get_rand() { return real_dist(rand_e); }
+size_t TwoDimWorldScene::get_terrain_chunk_count() const {
+  return terrain.get_chunk_count();
+}
+
+size_t TwoDimWorldScene::get_terrain_loaded_count() const {
+  return terrain.get_loaded_count();
+}
+
+ParticleSystem &TwoDimWorldScene::get_particles() { return particles; }
+
+void TwoDimWorldScene::set_substep_bounds(int min, int max) {
+  min_substeps = std::clamp(min, 1, MAX_SUBSTEPS);
+  max_substeps = std::clamp(max, min_substeps, MAX_SUBSTEPS);
+  substep_count = std::clamp(substep_count, min_substeps, max_substeps);
+}
+
+int TwoDimWorldScene::get_substep_count() const { return substep_count; }
+
+int TwoDimWorldScene::get_min_substeps() const { return min_substeps; }
+
+int TwoDimWorldScene::get_max_substeps() const { return max_substeps; }
+
+DegradeLevel TwoDimWorldScene::get_degrade_level() const {
+  return degrade_level;
+}
+
+void TwoDimWorldScene::reset() {
+  // Pooled bodies stay pooled, live ones go back to the pools while there is
+  // room so the next run spawns without creating bodies.
+  for (int kind = 0; kind < BODY_KIND_COUNT; ++kind) {
+    const BodyKind body_kind = static_cast<BodyKind>(kind);
+    for (b2BodyId body_id : bodies.get_store(body_kind).body_ids) {
+      release_body(body_kind, body_id);
+    }
+  }
+  bodies.clear();
+
+  for (const auto &[id, sensor] : sensors) {
+    b2DestroyBody(sensor.body_id);
+  }
+  sensors.clear();
+  sensor_idx_counter = 0;
+
+  body_commands.clear();
+  // Right away, "scene_2d.create*(true)" may run before the next update.
+  reset_lua_body_cache();
+  flags.reset(6);
+  contact_begin_events.clear();
+  contact_end_events.clear();
+  sensor_begin_events.clear();
+  sensor_end_events.clear();
+  query_results.clear();
+  ray_hits.clear();
+  particles.clear();
+
+  step_accumulator = 0.0F;
+  interp_alpha = 1.0F;
+  substep_count = std::clamp(SUBSTEP_BASELINE, min_substeps, max_substeps);
+  max_body_speed_sq = 0.0F;
+  lua_update_countdown = 0;
+  lua_update_dt = 0.0F;
+  terrain_refresh_countdown = 0;
+  set_seed(rng_seed);
+}
+
+void TwoDimWorldScene::set_seed(uint32_t seed) {
+  rng_seed = seed;
+  rand_e.seed(seed);
+  real_dist.reset();
+}
+
+bool TwoDimWorldScene::start_recording(const std::string &path) {
+  if (input_recorder.is_active() || input_replayer.is_active() ||
+      flags.test(3) || flags.test(4)) {
+    return false;
+  }
+  recording_path = path;
+  flags.set(3);
+  return true;
+}
+
+bool TwoDimWorldScene::stop_recording() {
+  if (flags.test(3)) {
+    // Never started, nothing to write.
+    flags.reset(3);
+    return false;
+  }
+  return input_recorder.finish(recording_path);
+}
+
+bool TwoDimWorldScene::start_replay(const std::string &path) {
+  if (input_recorder.is_active() || flags.test(3) ||
+      !input_replayer.load(path)) {
+    return false;
+  }
+  flags.set(4);
+  return true;
+}
+
+void TwoDimWorldScene::stop_replay() {
+  flags.reset(4);
+  input_replayer.stop();
+}
+
+bool TwoDimWorldScene::is_replaying() const {
+  return input_replayer.is_active();
+}
+
+uint32_t TwoDimWorldScene::create_sensor(float x, float y, float hw,
+                                         float hh) {
+  // An id can only still be taken once the counter wrapped around.
+  uint32_t id = sensor_idx_counter++;
+  while (!create_sensor_with_id(id, x, y, hw, hh)) {
+    id = sensor_idx_counter++;
+  }
+  return id;
+}
+
+bool TwoDimWorldScene::create_sensor_with_id(uint32_t id, float x, float y,
+                                             float hw, float hh) {
+  if (sensors.contains(id)) {
+    return false;
+  }
+
+  b2BodyDef body_def = b2DefaultBodyDef();
+  body_def.position = b2Vec2{x, y};
+  b2BodyId body_id = b2CreateBody(this->world_id, &body_def);
+
+  b2Polygon box = b2MakeBox(hw, hh);
+  b2ShapeDef shape_def = b2DefaultShapeDef();
+  shape_def.isSensor = true;
+  shape_def.enableSensorEvents = true;
+  // Body user data is reserved for registry handles, the sensor id goes on
+  // the shape instead.
+  shape_def.userData = body_handle_to_user_data(id);
+  b2CreatePolygonShape(body_id, &shape_def, &box);
+
+  sensors.insert({id, SensorInfo{body_id, b2Vec2{x, y}, b2Vec2{hw, hh}}});
+  return true;
+}
+
+bool TwoDimWorldScene::destroy_sensor(uint32_t id) {
+  auto iter = sensors.find(id);
+  if (iter == sensors.end()) {
+    return false;
+  }
+  b2DestroyBody(iter->second.body_id);
+  sensors.erase(iter);
+  return true;
+}
 
 constexpr float TwoDimWorldScene::get_pixel_b2_ratio() {
   return PIXEL_B2UNIT_RATIO;
 }
 
 Color TwoDimWorldScene::get_random_color() {
-  return Color{static_cast<uint8_t>(GetRandomValue(127, 255)),
-               static_cast<uint8_t>(GetRandomValue(127, 255)),
-               static_cast<uint8_t>(GetRandomValue(127, 255)), 255};
+  std::uniform_int_distribution<int> channel_dist(127, 255);
+  return Color{static_cast<uint8_t>(channel_dist(rand_e)),
+               static_cast<uint8_t>(channel_dist(rand_e)),
+               static_cast<uint8_t>(channel_dist(rand_e)), 255};
 }
@@ -17,13 +17,22 @@
 #ifndef SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_2D_WORLD_SCENE_H_
 #define SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_2D_WORLD_SCENE_H_
 
+#include "body_registry.h"
+#include "byte_buffer.h"
+#include "input_recording.h"
+#include "instanced_renderer.h"
+#include "particle_system.h"
 #include "scene_system.h"
+#include "task_pool.h"
+#include "terrain.h"
+#include "vertex_transform.h"
 
 // third party includes
 #include <box2d/box2d.h>
 #include <raylib.h>
 
 // standard library includes
+#include <array>
 #include <bitset>
 #include <cstdint>
 #include <memory>
@@ -32,6 +41,8 @@
 #include <random>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 using std::numbers::sqrt2_v;
 
@@ -50,6 +61,35 @@ constexpr float RWALL_Y = 1.5F;
 constexpr float WALL_HW = 0.1F;
 constexpr float WALL_HH = 1.5F;
 
+// Binary snapshot format, see "TwoDimWorldScene::save_snapshot(...)".
+constexpr uint32_t SNAPSHOT_MAGIC = 0x50414E53;  // "SNAP"
+constexpr uint16_t SNAPSHOT_VERSION = 1;
+// MEMFS directory for snapshots saved from Lua, outlives the scene.
+constexpr const char *SNAPSHOT_DIR = "/snapshots";
+// MEMFS directory for input recordings saved from Lua.
+constexpr const char *RECORDING_DIR = "/recordings";
+// Lua registry fields holding the metatable of body userdata and the table of
+// each live body's userdata by id, see "scene_2d.body".
+constexpr const char *LUA_BODY_METATABLE = "scene_2d.body";
+constexpr const char *LUA_BODY_CACHE = "scene_2d.body_cache";
+
+// Extra Box2D units around the view when culling bodies to draw.
+constexpr float CULL_MARGIN = 0.5F;
+// Instanced mesh of particles, after the one mesh per BodyKind.
+constexpr uint32_t PARTICLE_MESH_IDX = BODY_KIND_COUNT;
+
+// Adaptive substeps, see "update_substep_count(...)". Substeps used while
+// anything moves, before adjusting for piles.
+constexpr int SUBSTEP_BASELINE = 4;
+// Box2D units per second below which the fastest body counts as calm.
+constexpr float SUBSTEP_CALM_SPEED = 0.5F;
+// Touching contacts per live body at which the bodies count as piled up, and
+// the substeps added for it.
+constexpr float SUBSTEP_PILE_CONTACT_RATIO = 1.5F;
+constexpr int SUBSTEP_PILE_EXTRA = 2;
+// Physics taking more than this fraction of the update's dt is over budget.
+constexpr float SUBSTEP_BUDGET_FRACTION = 0.5F;
+
 constexpr float BALL_R = 0.1F;
 constexpr b2Vec2 B_POINTS[8] = {
     {0.0F, -BALL_R},
@@ -65,18 +105,87 @@ constexpr b2Vec2 T_POINTS[4] = {
     {0.1F, -0.1F}, {-0.1F, -0.1F}, {-0.15F, 0.1F}, {0.15F, 0.1F}};
 constexpr float T_RADIUS = 0.0F;
 
-// Forward declaration
-class TwoDimWorldScene;
+// Bodies moving farther than this in one step are made bullets. Box2D only
+// sweeps plain dynamic bodies against static ones and collides once per step,
+// so more substeps wouldn't stop them tunneling through small bodies. Every
+// kind is at least "BALL_R" from its center to its edge, anything slower
+// can't pass through another body in one step.
+constexpr float BULLET_MIN_TRAVEL = BALL_R;
+
+// Precomputed creation data of one body kind, built once per scene.
+struct BodyPrototype {
+  b2BodyDef body_def;
+  b2ShapeDef shape_def;
+  b2Circle circle;
+  b2Polygon polygon;
+  // Uses "circle" if true, "polygon" otherwise.
+  bool is_circle;
+  // Default spawn x, the default spawn y is random.
+  float spawn_x;
+  b2Vec2 velocity;
+};
+
+struct SpawnParams {
+  // Defaults to the kind's spawn position (random y) for each body.
+  std::optional<b2Vec2> position;
+  // Defaults to the kind's initial velocity.
+  std::optional<b2Vec2> velocity;
+  // Offset added per spawned body, the n-th body is at "position + n *
+  // spacing".
+  b2Vec2 spacing;
+  // Defaults to a random color per body.
+  std::optional<Color> color;
+};
 
-struct TDWSPtrHolder {
-  TwoDimWorldScene *scene_ptr;
+struct SensorInfo {
+  b2BodyId body_id;
+  b2Vec2 pos;
+  b2Vec2 half_extents;
 };
 
-struct BodyInfo {
-  b2BodyId id;
-  Color color;
+enum class BodyCommandType : uint8_t { SET_POS, IMPULSE };
+
+// A body write from Lua, applied in "TwoDimWorldScene::apply_body_commands()".
+struct BodyCommand {
+  uint32_t handle;
+  BodyKind kind;
+  BodyCommandType type;
+  // Position or linear impulse.
+  b2Vec2 value;
+};
+
+// Duration of each part of the latest "TwoDimWorldScene::update(...)" in
+// microseconds. Read by the headless runner.
+struct UpdateTimings {
+  // Starting a recording/replay and gathering input.
+  float input_us;
+  // Lua input callbacks and "scene_2d.update".
+  float lua_us;
+  // Every Box2D step taken this update, including cached transform updates.
+  float physics_us;
+  // Just the "b2World_Step" calls within "physics_us".
+  float world_step_us;
+  // Contact and sensor events delivered to Lua.
+  float events_us;
+  // Emitters and integration of "ParticleSystem".
+  float particles_us;
+};
+
+// Reuse counters of one kind's pool of disabled bodies.
+struct BodyPoolStats {
+  size_t pooled;
+  // Most bodies of the kind alive at once.
+  size_t peak_live;
+  // Creates served from the pool.
+  uint64_t reused;
+  // Creates that needed a new Box2D body.
+  uint64_t created;
 };
 
+// Forward declarations
+struct lua_State;
+class TwoDimWorldScene;
+
 class TwoDimWorldScene : public Scene {
  public:
   TwoDimWorldScene(SceneSystem *ctx);
@@ -111,32 +220,276 @@ class TwoDimWorldScene : public Scene {
   void apply_octagon_impulse(uint32_t idx, float x, float y);
   void set_octagon_color(uint32_t idx, Color color);
 
+  // Returns BODY_HANDLE_INVALID if the body limit was reached.
+  uint32_t spawn_body(BodyKind kind, b2Vec2 pos, b2Vec2 vel,
+                      std::optional<Color> color);
+  // Creates up to "count" bodies, stops early if the body limit is reached.
+  // Handles of created bodies are appended to "ids_out" if not null.
+  void spawn_bodies(BodyKind kind, int count, const SpawnParams &params,
+                    std::vector<uint32_t> *ids_out);
+  b2Vec2 get_default_spawn_pos(BodyKind kind);
+
+  // Static box sensor, overlaps are reported to "scene_2d.contact_callback".
+  uint32_t create_sensor(float x, float y, float hw, float hh);
+  bool destroy_sensor(uint32_t id);
+
+  // Serializes every body (id, kind, transform, velocities, sleep state,
+  // color), the id allocator state and sensors. Box2D's internal contact
+  // cache isn't included, so a restored world may diverge slightly from the
+  // original after a few steps.
+  void save_snapshot(std::vector<uint8_t> *out) const;
+  // Returns false and leaves the world untouched if "data" isn't valid.
+  bool restore_snapshot(const std::vector<uint8_t> &data);
+  bool save_snapshot_file(const std::string &path) const;
+  bool load_snapshot_file(const std::string &path);
+
+  // Removes every dynamic body, sensor and particle and rewinds sensor ids and
+  // the RNG, keeping the Box2D world, static geometry, terrain and the
+  // "scene_2d" bindings. Body ids from before never resolve again.
+  // "scene_2d.init" isn't called again. Much cheaper than rebuilding the
+  // scene.
+  void reset();
+
+  // Reseeds the RNG behind "get_rand()" and random body colors.
+  void set_seed(uint32_t seed);
+  // Recording and replay start at the beginning of the next update. Both
+  // restore the world from a snapshot and reseed the C++ and Lua RNGs, so a
+  // replay feeds the same input and dt to the same starting state. Returns
+  // false if a recording or replay is already running.
+  bool start_recording(const std::string &path);
+  // Writes the recording started by "start_recording(...)".
+  bool stop_recording();
+  bool start_replay(const std::string &path);
+  void stop_replay();
+  bool is_replaying() const;
+
+  // Ids of dynamic bodies overlapping the given area. The returned vector is
+  // reused by the next query. "cast_ray(...)" orders ids nearest first.
+  const std::vector<uint32_t> &query_aabb(b2AABB aabb);
+  const std::vector<uint32_t> &query_circle(b2Vec2 center, float radius);
+  const std::vector<uint32_t> &cast_ray(b2Vec2 origin, b2Vec2 translation);
+
+  // Area of the world currently on screen, in Box2D units.
+  b2AABB get_visible_aabb() const;
+  // "x" and "y" are the top-left corner of the view in Box2D units.
+  void set_camera(float x, float y, float zoom);
+
+  // Shared implementation of the per-kind functions above, also bound to Lua
+  // for every kind as "createball", "setoctagonpos" and so on. "idx" is a
+  // handle from "bodies" and must belong to a body of "kind".
+  uint32_t create_body(BodyKind kind);
+  bool destroy_body(BodyKind kind, uint32_t idx);
+  b2Vec2 get_body_pos(BodyKind kind, uint32_t idx) const;
+  void set_body_pos(BodyKind kind, uint32_t idx, float x, float y);
+  b2Vec2 get_body_vel(BodyKind kind, uint32_t idx) const;
+  void apply_body_impulse(BodyKind kind, uint32_t idx, float x, float y);
+  void set_body_color(BodyKind kind, uint32_t idx, Color color);
+  // Deferred "set_body_pos(...)" and "apply_body_impulse(...)" used by the
+  // Lua bindings. Commands are applied in one batch right before the next
+  // physics step, until then reads return the previous state.
+  void queue_body_pos(BodyKind kind, uint32_t idx, float x, float y);
+  void queue_body_impulse(BodyKind kind, uint32_t idx, float x, float y);
+
   float get_rand();
 
+  const UpdateTimings &get_update_timings() const;
+  size_t get_body_count() const;
+  bool has_body(BodyKind kind, uint32_t idx) const;
+  std::optional<BodyKind> get_body_kind(uint32_t idx) const;
+  // Every live body of "kind" with the state cached after the latest step.
+  const BodyRegistry::KindStore &get_body_store(BodyKind kind) const;
+  const BodyPoolStats &get_body_pool_stats(BodyKind kind) const;
+
+  // Bounds of the adaptive substep count, clamped to 1-MAX_SUBSTEPS.
+  void set_substep_bounds(int min, int max);
+  int get_substep_count() const;
+  int get_min_substeps() const;
+  int get_max_substeps() const;
+  // The SceneSystem's level as of the latest update.
+  DegradeLevel get_degrade_level() const;
+
+  // Replaces the built-in ground and walls with chunked terrain from a file,
+  // see TerrainStreamer. Chunks are created and destroyed around the camera
+  // and the bodies as they move.
+  bool load_terrain(const std::string &path);
+  // Rebuilds the built-in walls to reach "height" above the ground, for scenes
+  // stacking more bodies than the default walls hold. Does nothing once
+  // terrain replaced them.
+  void set_wall_height(float height);
+  size_t get_terrain_chunk_count() const;
+  size_t get_terrain_loaded_count() const;
+
+  // Cosmetic particles, drawn above bodies. See ParticleSystem.
+  ParticleSystem &get_particles();
+
   constexpr static float get_pixel_b2_ratio();
 
+  // Scene behind a handle held by "scene_2d" closures, nullptr once that
+  // scene is destroyed. Handles are "(generation << 32) | slot" and a slot's
+  // generation changes when its scene is destroyed, so a stale closure can't
+  // reach a freed or newer scene. Unlike locking a weak_ptr this allocates
+  // nothing and has no refcount traffic, so it is cheap enough per call.
+  static TwoDimWorldScene *from_lua_handle(int64_t handle);
+
  private:
   std::string lua_error_text;
-  std::shared_ptr<TDWSPtrHolder> ptr_ctx;
-  std::unordered_map<uint32_t, BodyInfo> ball_ids;
-  std::unordered_map<uint32_t, BodyInfo> octagon_ids;
-  std::unordered_map<uint32_t, BodyInfo> trapezoid_ids;
-  std::default_random_engine rand_e;
+  // Upvalue 1 of every "scene_2d" closure, see "from_lua_handle(...)".
+  int64_t lua_handle;
+  // Owned by the SceneSystem, outlives the scene.
+  lua_State *lua_state;
+  std::unique_ptr<TaskPool> task_pool;
+  BodyRegistry bodies;
+  std::unique_ptr<InstancedShapeRenderer> instanced_renderer;
+  // Reused every frame to build instance records.
+  std::vector<ShapeInstance> instance_buffer;
+  // Reused every frame by the non-instanced polygon path.
+  std::vector<b2Transform> transform_buffer;
+  std::vector<Vector2> vertex_buffer;
+  // Dense indices per kind of bodies to draw this frame.
+  std::array<std::vector<uint32_t>, BODY_KIND_COUNT> visible_indices;
+  Camera2D camera;
+  std::unordered_map<uint32_t, SensorInfo> sensors;
+  // Collected after every step, delivered to Lua once per update.
+  // Pairs of (body id, body id) or (sensor id, body id), -1 for static bodies.
+  std::vector<std::pair<int64_t, int64_t> > contact_begin_events;
+  std::vector<std::pair<int64_t, int64_t> > contact_end_events;
+  std::vector<std::pair<int64_t, int64_t> > sensor_begin_events;
+  std::vector<std::pair<int64_t, int64_t> > sensor_end_events;
+  std::vector<uint32_t> query_results;
+  // Queued by Lua since the last physics step.
+  std::vector<BodyCommand> body_commands;
+  // (fraction, id) of the current ray cast.
+  std::vector<std::pair<float, uint32_t> > ray_hits;
+  b2AABB query_aabb_bounds;
+  uint32_t sensor_idx_counter;
+  InputRecorder input_recorder;
+  InputReplayer input_replayer;
+  // Input consumed by the current update.
+  InputFrame input_frame;
+  std::string recording_path;
+  uint32_t rng_seed;
+  // Fixed engine so a seed gives the same sequence on every platform.
+  std::mt19937 rand_e;
   std::uniform_real_distribution<float> real_dist;
   // 0 - error occurred
   // 1 - gamepad 0 is available
+  // 2 - fixed timestep used last update, draw interpolates transforms
+  // 3 - start input recording on next update
+  // 4 - start input replay on next update
+  // 5 - built-in ground and walls replaced by "terrain"
+  // 6 - bodies were destroyed, prune LUA_BODY_CACHE on next update
   std::bitset<32> flags;
-  std::optional<b2Polygon> cached_octagon_polygon;
-  std::optional<b2Polygon> cached_trapezoid_polygon;
+  std::array<BodyPrototype, BODY_KIND_COUNT> prototypes;
+  // Disabled bodies with the kind's shape, re-enabled by "acquire_body(...)"
+  // instead of creating a body. Avoids Box2D allocations and broadphase
+  // rebuilds when scripts create and destroy bodies every frame.
+  std::array<std::vector<b2BodyId>, BODY_KIND_COUNT> body_pools;
+  // Bodies disabled since the last step. Box2D reports the end events of
+  // their contacts after the next step and they are looked up through the
+  // shape's current body, so they join "body_pools" only after that.
+  std::array<std::vector<b2BodyId>, BODY_KIND_COUNT> released_bodies;
+  std::array<BodyPoolStats, BODY_KIND_COUNT> body_pool_stats;
+  size_t body_pool_size;
   b2WorldId world_id;
   b2BodyId ground_id;
   b2BodyId left_wall_id;
   b2BodyId right_wall_id;
-  uint32_t ball_idx_counter;
-  uint32_t octagon_idx_counter;
-  uint32_t trapezoid_idx_counter;
+  // WALL_HH unless "set_wall_height(...)" raised the walls.
+  float wall_half_height;
+
+  float step_accumulator;
+  // Fraction of a fixed step remaining in "step_accumulator" after stepping.
+  float interp_alpha;
+  UpdateTimings update_timings;
+  TerrainStreamer terrain;
+  // Reused by "refresh_terrain()".
+  std::vector<int64_t> terrain_keys;
+  // Chunk ranges of bodies as min x, min y, max x and max y.
+  std::vector<std::array<int32_t, 4> > terrain_body_ranges;
+  int terrain_refresh_countdown;
+  int min_substeps;
+  int max_substeps;
+  // SimSettings bounds last applied, Settings changes override "setsubsteps".
+  int settings_min_substeps;
+  int settings_max_substeps;
+  // Substeps of every "b2World_Step" in the next update.
+  int substep_count;
+  // Squared speed of the fastest body that moved in the current update.
+  float max_body_speed_sq;
+  // Begin minus end contact events seen so far. Box2D's counters include
+  // contacts of shapes whose bounding boxes merely overlap.
+  int64_t touching_contacts;
+  DegradeLevel degrade_level;
+  // Updates left before the next "scene_2d.update" call and the dt summed
+  // for it, more than one update apart when Lua is throttled.
+  int lua_update_countdown;
+  float lua_update_dt;
+  ParticleSystem particles;
+
+  struct LuaHandleSlot {
+    TwoDimWorldScene *scene;
+    uint32_t generation;
+  };
+  // Shared by every scene, a slot is reused once its scene is destroyed.
+  static std::vector<LuaHandleSlot> lua_handle_slots;
+  static int64_t acquire_lua_handle(TwoDimWorldScene *scene);
+  static void release_lua_handle(int64_t handle);
+
+  uint32_t register_body(BodyKind kind, b2BodyId body_id);
+  b2BodyId create_prototype_body(BodyKind kind, const b2BodyDef &body_def);
+  // Takes a pooled body set up from "body_def", or creates one if the pool is
+  // empty.
+  b2BodyId acquire_body(BodyKind kind, const b2BodyDef &body_def);
+  // Disables and pools "body_id", or destroys it if the pool is full.
+  void release_body(BodyKind kind, b2BodyId body_id);
+  // Creates "left_wall_id" and "right_wall_id" for "wall_half_height".
+  void create_walls();
+  // Moves "released_bodies" into "body_pools", once their events are out.
+  void pool_released_bodies();
+  void store_prev_transforms();
+  // Starts an empty LUA_BODY_CACHE, for when every body is replaced at once.
+  void reset_lua_body_cache();
+  // Drops userdata of bodies that no longer exist from LUA_BODY_CACHE.
+  void prune_lua_body_cache(lua_State *lua_ctx);
+  void apply_body_commands();
+  // Steps the world and refreshes cached transforms of bodies that moved.
+  void step_world(float step_dt);
+  // Returns false without creating anything if "id" is taken.
+  bool create_sensor_with_id(uint32_t id, float x, float y, float hw,
+                             float hh);
+  void collect_contact_events();
+  void deliver_contact_events(lua_State *lua_ctx);
+  // True if "degrade_level" includes "level" and nothing requires the
+  // simulation to run at full fidelity (recording or replaying input).
+  bool is_sim_degraded(DegradeLevel level) const;
+  // Picks "substep_count" for the next update from this update's body speeds,
+  // contacts and physics time. Only called for updates that took a step.
+  void update_substep_count(float dt);
+  // Creates terrain chunks near the camera or any body, destroys the rest.
+  // Bodies keep chunks loaded along "lookahead" seconds of their velocity.
+  void refresh_terrain(float lookahead);
+  // Starts a requested recording or replay, see "start_recording(...)".
+  void apply_pending_input_mode(lua_State *lua_ctx);
+  // Scene id of the body owning "shape_id", -1 if it isn't in "bodies".
+  int64_t get_shape_body_id(b2ShapeId shape_id) const;
+  int64_t get_shape_sensor_id(b2ShapeId shape_id) const;
+  static bool query_aabb_callback(b2ShapeId shape_id, void *ctx);
+  static bool query_shape_callback(b2ShapeId shape_id, void *ctx);
+  static float cast_ray_callback(b2ShapeId shape_id, b2Vec2 point,
+                                 b2Vec2 normal, float fraction, void *ctx);
+  void init_prototypes();
+  void init_instanced_meshes();
+  void draw_bodies_instanced(float alpha);
+  // Writes interpolated transforms of "store" at "indices" to
+  // "transform_buffer".
+  void fill_interpolated_transforms(const BodyRegistry::KindStore &store,
+                                    const std::vector<uint32_t> &indices,
+                                    float alpha);
+  // Fills "visible_indices", with every body if "cull" is false.
+  void collect_visible_bodies(bool cull);
+  static bool cull_query_callback(b2ShapeId shape_id, void *ctx);
 
-  static Color get_random_color();
+  Color get_random_color();
 };
 
 #endif
@@ -0,0 +1,365 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "benchmark_scene.h"
+
+// third party includes
+#include <imgui.h>
+
+// standard library includes
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <iterator>
+#include <print>
+#include <string_view>
+
+// local includes
+#include "task_pool.h"
+#include "vertex_transform.h"
+#include "web_util.h"
+
+namespace {
+
+float elapsed_us(std::chrono::steady_clock::time_point from) {
+  return std::chrono::duration<float, std::micro>(
+             std::chrono::steady_clock::now() - from)
+      .count();
+}
+
+std::string json_escape(std::string_view str) {
+  std::string ret;
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      ret.push_back('\\');
+      ret.push_back(c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      std::format_to(std::back_inserter(ret), "\\u{:04x}",
+                     static_cast<int>(c));
+    } else {
+      ret.push_back(c);
+    }
+  }
+  return ret;
+}
+
+void append_stats_json(std::string *out, const char *name,
+                       const TimingStats &stats) {
+  std::format_to(std::back_inserter(*out),
+                 "\"{}\": {{\"mean\": {:.2f}, \"p50\": {:.2f}, "
+                 "\"p90\": {:.2f}, \"p99\": {:.2f}, \"max\": {:.2f}}}",
+                 name, stats.mean, stats.p50, stats.p90, stats.p99,
+                 stats.max);
+}
+
+}  // namespace
+
+BenchmarkScene::BenchmarkScene(SceneSystem *ctx)
+    : Scene(ctx),
+      world(std::make_unique<TwoDimWorldScene>(ctx)),
+      churn_bodies(),
+      spawned_ids(),
+      samples(),
+      results(),
+      selected_scenario(0),
+      frame_idx(0),
+      scenario(BenchmarkScenario::BALL_PILE),
+      flags() {}
+
+BenchmarkScene::~BenchmarkScene() {}
+
+void BenchmarkScene::update(SceneSystem *ctx, float dt) {
+  if (!flags.test(0)) {
+    world->update(ctx, dt);
+    return;
+  }
+
+  tick_scenario();
+  world->update(ctx, BENCHMARK_FRAME_DT);
+
+  if (frame_idx >= BENCHMARK_WARMUP_FRAMES) {
+    const UpdateTimings &timings = world->get_update_timings();
+    samples[LUA].push_back(timings.lua_us);
+    samples[STEP].push_back(timings.world_step_us);
+    samples[FRAME].push_back(dt * 1000000.0F);
+  }
+}
+
+void BenchmarkScene::draw(SceneSystem *ctx) {
+  const auto draw_start = std::chrono::steady_clock::now();
+  world->draw(ctx);
+  if (!flags.test(0)) {
+    return;
+  }
+
+  if (frame_idx >= BENCHMARK_WARMUP_FRAMES) {
+    samples[DRAW].push_back(elapsed_us(draw_start));
+  }
+  if (++frame_idx >= BENCHMARK_WARMUP_FRAMES + BENCHMARK_SAMPLE_FRAMES) {
+    finish_scenario(ctx);
+  }
+}
+
+void BenchmarkScene::draw_rlimgui(SceneSystem *ctx) {
+  world->draw_rlimgui(ctx);
+}
+
+bool BenchmarkScene::allow_draw_below(SceneSystem *ctx) { return false; }
+
+void BenchmarkScene::draw_config_tab(SceneSystem *ctx) {
+  if (flags.test(0)) {
+    ImGui::Text("Running \"%s\": frame %d of %d",
+                BENCHMARK_SCENARIO_LABELS[static_cast<int>(scenario)],
+                frame_idx, BENCHMARK_WARMUP_FRAMES + BENCHMARK_SAMPLE_FRAMES);
+    if (ImGui::Button("Stop")) {
+      flags.reset(0);
+      flags.reset(1);
+    }
+  } else {
+    ImGui::Combo("Scenario", &selected_scenario, BENCHMARK_SCENARIO_LABELS,
+                 BENCHMARK_SCENARIO_COUNT);
+    if (ImGui::Button("Run")) {
+      start(ctx, static_cast<BenchmarkScenario>(selected_scenario));
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Run All")) {
+      flags.set(1);
+      start(ctx, BenchmarkScenario::BALL_PILE);
+    }
+  }
+
+  ImGui::TextWrapped(
+      "Each scenario starts a fresh world, runs %d warm-up frames and then "
+      "samples %d frames, stepping %.4f seconds per frame. Times are p50 / "
+      "p99 in microseconds. \"Draw\" is CPU time spent issuing draw calls, "
+      "\"Frame\" is the time between frames.",
+      BENCHMARK_WARMUP_FRAMES, BENCHMARK_SAMPLE_FRAMES, BENCHMARK_FRAME_DT);
+
+  if (results.empty()) {
+    return;
+  }
+
+  if (ImGui::BeginTable("BenchmarkResults", 6,
+                        ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+    ImGui::TableSetupColumn("Scenario");
+    ImGui::TableSetupColumn("Bodies");
+    ImGui::TableSetupColumn("Lua");
+    ImGui::TableSetupColumn("b2World_Step");
+    ImGui::TableSetupColumn("Draw");
+    ImGui::TableSetupColumn("Frame");
+    ImGui::TableHeadersRow();
+    for (const BenchmarkResult &result : results) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(
+          BENCHMARK_SCENARIO_LABELS[static_cast<int>(result.scenario)]);
+      ImGui::TableNextColumn();
+      ImGui::Text("%zu", result.body_count);
+      for (const TimingStats *stats :
+           {&result.lua_us, &result.step_us, &result.draw_us,
+            &result.frame_us}) {
+        ImGui::TableNextColumn();
+        ImGui::Text("%.0f / %.0f", stats->p50, stats->p99);
+      }
+    }
+    ImGui::EndTable();
+  }
+
+  if (ImGui::Button("Download JSON")) {
+    download_text_file("benchmark_results.json", results_to_json(ctx));
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Clear Results")) {
+    results.clear();
+  }
+}
+
+void BenchmarkScene::start(SceneSystem *ctx, BenchmarkScenario next) {
+  // The old world must be gone before the new one registers its Lua
+  // functions.
+  world.reset();
+  world = std::make_unique<TwoDimWorldScene>(ctx);
+  world->set_seed(BENCHMARK_SEED);
+
+  scenario = next;
+  frame_idx = 0;
+  churn_bodies.clear();
+  for (std::vector<float> &phase : samples) {
+    phase.clear();
+    phase.reserve(BENCHMARK_SAMPLE_FRAMES);
+  }
+  flags.set(0);
+
+  setup_scenario();
+}
+
+void BenchmarkScene::setup_scenario() {
+  switch (scenario) {
+    case BenchmarkScenario::BALL_PILE: {
+      // Rows of balls between the walls, stacked upwards from the ground.
+      // The walls are raised past the top row so no ball spills over.
+      constexpr int PER_ROW = 17;
+      constexpr float SPACING = 0.22F;
+      const int row_count = (BENCHMARK_PILE_BALLS + PER_ROW - 1) / PER_ROW;
+      world->set_wall_height(GROUND_Y - GROUND_HH - 2.7F +
+                             SPACING * static_cast<float>(row_count) + 1.0F);
+      for (int spawned = 0, row = 0; spawned < BENCHMARK_PILE_BALLS; ++row) {
+        const int count = std::min(PER_ROW, BENCHMARK_PILE_BALLS - spawned);
+        world->spawn_bodies(
+            BodyKind::BALL, count,
+            SpawnParams{b2Vec2{0.25F, 2.7F - SPACING * static_cast<float>(row)},
+                        b2Vec2{0.0F, 0.0F}, b2Vec2{SPACING, 0.0F},
+                        std::nullopt},
+            nullptr);
+        spawned += count;
+      }
+      break;
+    }
+    case BenchmarkScenario::AVALANCHE: {
+      // Rows alternate shape and sideways direction so they collide, between
+      // walls raised past the top row.
+      constexpr int PER_ROW = 15;
+      constexpr float SPACING = 0.25F;
+      // Each kind's last row is short if the rows don't divide evenly.
+      const int rows_per_kind =
+          (BENCHMARK_AVALANCHE_PER_KIND + PER_ROW - 1) / PER_ROW;
+      const int row_count = rows_per_kind * BODY_KIND_COUNT;
+      world->set_wall_height(GROUND_Y - GROUND_HH - 2.0F +
+                             0.3F * static_cast<float>(row_count) + 1.0F);
+      for (int row = 0; row < row_count; ++row) {
+        const int kind_row = row / BODY_KIND_COUNT;
+        const int count = std::min(
+            PER_ROW, BENCHMARK_AVALANCHE_PER_KIND - kind_row * PER_ROW);
+        const float vel_x = row % 2 == 0 ? 2.0F : -2.0F;
+        world->spawn_bodies(
+            static_cast<BodyKind>(row % BODY_KIND_COUNT), count,
+            SpawnParams{b2Vec2{0.2F, 2.0F - 0.3F * static_cast<float>(row)},
+                        b2Vec2{vel_x, 0.0F}, b2Vec2{SPACING, 0.0F},
+                        std::nullopt},
+            nullptr);
+      }
+      break;
+    }
+    case BenchmarkScenario::CHURN:
+      for (int idx = 0; idx < BENCHMARK_CHURN_BODIES; ++idx) {
+        spawn_tracked(static_cast<BodyKind>(idx % BODY_KIND_COUNT), 1,
+                      SpawnParams{std::nullopt, std::nullopt,
+                                  b2Vec2{0.0F, 0.0F}, std::nullopt});
+      }
+      break;
+  }
+}
+
+void BenchmarkScene::tick_scenario() {
+  if (scenario != BenchmarkScenario::CHURN) {
+    return;
+  }
+
+  for (int idx = 0; idx < BENCHMARK_CHURN_PER_FRAME && !churn_bodies.empty();
+       ++idx) {
+    const auto [kind, handle] = churn_bodies.front();
+    churn_bodies.pop_front();
+    world->destroy_body(kind, handle);
+  }
+  for (int idx = 0; idx < BENCHMARK_CHURN_PER_FRAME; ++idx) {
+    spawn_tracked(static_cast<BodyKind>((frame_idx + idx) % BODY_KIND_COUNT),
+                  1,
+                  SpawnParams{std::nullopt, std::nullopt, b2Vec2{0.0F, 0.0F},
+                              std::nullopt});
+  }
+}
+
+void BenchmarkScene::finish_scenario(SceneSystem *ctx) {
+  flags.reset(0);
+
+  BenchmarkResult result{scenario,
+                         static_cast<int>(samples[FRAME].size()),
+                         world->get_body_count(),
+                         compute_timing_stats(&samples[LUA]),
+                         compute_timing_stats(&samples[STEP]),
+                         compute_timing_stats(&samples[DRAW]),
+                         compute_timing_stats(&samples[FRAME])};
+  results.push_back(result);
+  std::println(stdout,
+               "Benchmark \"{}\" done: step p50 {:.0f}us, frame p50 {:.0f}us.",
+               BENCHMARK_SCENARIO_NAMES[static_cast<int>(scenario)],
+               result.step_us.p50, result.frame_us.p50);
+
+  const int next = static_cast<int>(scenario) + 1;
+  if (flags.test(1) && next < BENCHMARK_SCENARIO_COUNT) {
+    start(ctx, static_cast<BenchmarkScenario>(next));
+  } else {
+    flags.reset(1);
+  }
+}
+
+void BenchmarkScene::spawn_tracked(BodyKind kind, int count,
+                                   const SpawnParams &params) {
+  spawned_ids.clear();
+  world->spawn_bodies(kind, count, params, &spawned_ids);
+  for (uint32_t handle : spawned_ids) {
+    churn_bodies.emplace_back(kind, handle);
+  }
+}
+
+std::string BenchmarkScene::results_to_json(SceneSystem *ctx) const {
+  const SimSettings &settings = ctx->get_sim_settings();
+  std::string out;
+  auto iter = std::back_inserter(out);
+
+  std::format_to(iter, "{{\n  \"user_agent\": \"{}\",\n",
+                 json_escape(get_user_agent()));
+  std::format_to(iter,
+                 "  \"build\": {{\"threads\": {}, \"simd\": \"{}\"}},\n",
+                 TASK_POOL_HAS_THREADS,
+                 VERTEX_TRANSFORM_SIMD_NAME ? VERTEX_TRANSFORM_SIMD_NAME
+                                            : "none");
+  std::format_to(
+      iter,
+      "  \"settings\": {{\"fixed_step_enabled\": {}, \"fixed_step_rate\": {}, "
+      "\"max_catchup_steps\": {}, \"physics_thread_count\": {}, "
+      "\"min_substeps\": {}, \"max_substeps\": {}, "
+      "\"instanced_rendering\": {}, \"cull_offscreen\": {}}},\n",
+      settings.fixed_step_enabled, settings.fixed_step_rate,
+      settings.max_catchup_steps, settings.physics_thread_count,
+      settings.min_substeps, settings.max_substeps,
+      settings.instanced_rendering, settings.cull_offscreen);
+  std::format_to(iter,
+                 "  \"warmup_frames\": {},\n  \"frame_dt\": {:.6f},\n"
+                 "  \"results\": [",
+                 BENCHMARK_WARMUP_FRAMES, BENCHMARK_FRAME_DT);
+
+  for (size_t idx = 0; idx < results.size(); ++idx) {
+    const BenchmarkResult &result = results[idx];
+    std::format_to(iter,
+                   "{}\n    {{\"scenario\": \"{}\", \"frames\": {}, "
+                   "\"bodies\": {},\n     ",
+                   idx == 0 ? "" : ",",
+                   BENCHMARK_SCENARIO_NAMES[static_cast<int>(result.scenario)],
+                   result.frame_count, result.body_count);
+    append_stats_json(&out, "lua_us", result.lua_us);
+    out.append(",\n     ");
+    append_stats_json(&out, "step_us", result.step_us);
+    out.append(",\n     ");
+    append_stats_json(&out, "draw_us", result.draw_us);
+    out.append(",\n     ");
+    append_stats_json(&out, "frame_us", result.frame_us);
+    out.append("}");
+  }
+  out.append("\n  ]\n}\n");
+
+  return out;
+}
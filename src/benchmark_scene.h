@@ -0,0 +1,111 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_BENCHMARK_SCENE_H_
+#define SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_BENCHMARK_SCENE_H_
+
+#include "2d_world_scene.h"
+#include "scene_system.h"
+#include "timing_stats.h"
+
+// standard library includes
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+enum class BenchmarkScenario : uint8_t {
+  BALL_PILE = 0,
+  AVALANCHE = 1,
+  CHURN = 2
+};
+constexpr int BENCHMARK_SCENARIO_COUNT = 3;
+
+// Used as keys in the exported JSON, indexed by BenchmarkScenario.
+constexpr const char *BENCHMARK_SCENARIO_NAMES[BENCHMARK_SCENARIO_COUNT] = {
+    "ball_pile", "avalanche", "churn"};
+constexpr const char *BENCHMARK_SCENARIO_LABELS[BENCHMARK_SCENARIO_COUNT] = {
+    "5k Ball Pile", "Mixed-shape Avalanche", "Spawn/Destroy Churn"};
+
+// Frames run before sampling starts, covers setup and first-frame hitches.
+constexpr int BENCHMARK_WARMUP_FRAMES = 30;
+constexpr int BENCHMARK_SAMPLE_FRAMES = 600;
+// Every frame steps the world by this much regardless of the actual frame
+// time, so all runs do the same simulation work.
+constexpr float BENCHMARK_FRAME_DT = 1.0F / 60.0F;
+constexpr uint32_t BENCHMARK_SEED = 1;
+
+constexpr int BENCHMARK_PILE_BALLS = 5000;
+constexpr int BENCHMARK_AVALANCHE_PER_KIND = 1000;
+constexpr int BENCHMARK_CHURN_BODIES = 1000;
+constexpr int BENCHMARK_CHURN_PER_FRAME = 50;
+
+struct BenchmarkResult {
+  BenchmarkScenario scenario;
+  int frame_count;
+  // Dynamic bodies at the end of the run.
+  size_t body_count;
+  // Microseconds per frame.
+  TimingStats lua_us;
+  TimingStats step_us;
+  TimingStats draw_us;
+  TimingStats frame_us;
+};
+
+// Runs fixed stress scenarios in a fresh TwoDimWorldScene and records timings
+// per frame. Controlled from the "Benchmark" tab of the config window.
+class BenchmarkScene : public Scene {
+ public:
+  BenchmarkScene(SceneSystem *ctx);
+  virtual ~BenchmarkScene() override;
+
+  virtual void update(SceneSystem *ctx, float dt) override;
+  virtual void draw(SceneSystem *ctx) override;
+  virtual void draw_rlimgui(SceneSystem *ctx) override;
+  virtual bool allow_draw_below(SceneSystem *ctx) override;
+
+  // Contents of the "Benchmark" tab, called by SceneSystem.
+  void draw_config_tab(SceneSystem *ctx);
+
+ private:
+  enum Sample { LUA = 0, STEP = 1, DRAW = 2, FRAME = 3, SAMPLE_COUNT = 4 };
+
+  std::unique_ptr<TwoDimWorldScene> world;
+  // Bodies alive in the churn scenario, oldest first.
+  std::deque<std::pair<BodyKind, uint32_t> > churn_bodies;
+  std::vector<uint32_t> spawned_ids;
+  std::array<std::vector<float>, SAMPLE_COUNT> samples;
+  std::vector<BenchmarkResult> results;
+  int selected_scenario;
+  int frame_idx;
+  BenchmarkScenario scenario;
+  // 0 - a scenario is running
+  // 1 - running every scenario in order
+  std::bitset<32> flags;
+
+  void start(SceneSystem *ctx, BenchmarkScenario next);
+  void setup_scenario();
+  void tick_scenario();
+  void finish_scenario(SceneSystem *ctx);
+  void spawn_tracked(BodyKind kind, int count, const SpawnParams &params);
+  std::string results_to_json(SceneSystem *ctx) const;
+};
+
+#endif
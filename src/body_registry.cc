@@ -0,0 +1,232 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "body_registry.h"
+
+std::optional<BodyKind> body_kind_from_name(std::string_view name) {
+  for (int kind = 0; kind < BODY_KIND_COUNT; ++kind) {
+    if (name == BODY_KIND_NAMES[kind]) {
+      return static_cast<BodyKind>(kind);
+    }
+  }
+  return std::nullopt;
+}
+
+size_t BodyRegistry::KindStore::size() const { return body_ids.size(); }
+
+BodyRegistry::BodyRegistry() : stores(), slots(), free_slots() {}
+
+uint32_t BodyRegistry::insert(BodyKind kind, b2BodyId body_id, Color color,
+                              b2Transform transform, b2Vec2 velocity) {
+  uint32_t slot_idx;
+  if (!free_slots.empty()) {
+    slot_idx = free_slots.front();
+    free_slots.pop_front();
+  } else if (slots.size() < BODY_REGISTRY_CAPACITY) {
+    slot_idx = static_cast<uint32_t>(slots.size());
+    slots.push_back(Slot{0, 0, kind, false});
+  } else {
+    return BODY_HANDLE_INVALID;
+  }
+
+  KindStore &store = stores[static_cast<size_t>(kind)];
+  Slot &slot = slots[slot_idx];
+  slot.dense_idx = static_cast<uint32_t>(store.size());
+  slot.kind = kind;
+  slot.alive = true;
+
+  const uint32_t handle = make_handle(slot_idx, slot.generation);
+  push_body(store, handle, body_id, color, transform, velocity);
+
+  return handle;
+}
+
+bool BodyRegistry::erase(uint32_t handle, BodyKind kind) {
+  std::optional<uint32_t> dense_idx = find(handle, kind);
+  if (!dense_idx.has_value()) {
+    return false;
+  }
+
+  // Swap with the last element to keep the store dense.
+  KindStore &store = stores[static_cast<size_t>(kind)];
+  const uint32_t idx = dense_idx.value();
+  const uint32_t last = static_cast<uint32_t>(store.size() - 1);
+  if (idx != last) {
+    store.body_ids[idx] = store.body_ids[last];
+    store.colors[idx] = store.colors[last];
+    store.transforms[idx] = store.transforms[last];
+    store.velocities[idx] = store.velocities[last];
+    store.prev_transforms[idx] = store.prev_transforms[last];
+    store.handles[idx] = store.handles[last];
+    slots[store.handles[idx] & BODY_HANDLE_INDEX_MASK].dense_idx = idx;
+  }
+  store.body_ids.pop_back();
+  store.colors.pop_back();
+  store.transforms.pop_back();
+  store.velocities.pop_back();
+  store.prev_transforms.pop_back();
+  store.handles.pop_back();
+
+  free_slot(handle & BODY_HANDLE_INDEX_MASK);
+
+  return true;
+}
+
+void BodyRegistry::clear() {
+  for (KindStore &store : stores) {
+    store.body_ids.clear();
+    store.colors.clear();
+    store.transforms.clear();
+    store.velocities.clear();
+    store.prev_transforms.clear();
+    store.handles.clear();
+  }
+  // Slots are kept and live ones are freed like in "erase(...)", so ids
+  // handed out before stay stale instead of naming the next bodies.
+  free_slots.clear();
+  for (uint32_t slot_idx = 0; slot_idx < slots.size(); ++slot_idx) {
+    const Slot &slot = slots[slot_idx];
+    if (slot.alive) {
+      free_slot(slot_idx);
+    } else if (!is_retired(slot)) {
+      free_slots.push_back(slot_idx);
+    }
+  }
+}
+
+std::optional<uint32_t> BodyRegistry::find(uint32_t handle,
+                                           BodyKind kind) const {
+  const uint32_t slot_idx = handle & BODY_HANDLE_INDEX_MASK;
+  if (slot_idx >= slots.size()) {
+    return std::nullopt;
+  }
+
+  const Slot &slot = slots[slot_idx];
+  if (!slot.alive || slot.kind != kind ||
+      slot.generation != (handle >> BODY_HANDLE_INDEX_BITS)) {
+    return std::nullopt;
+  }
+
+  return slot.dense_idx;
+}
+
+std::optional<BodyKind> BodyRegistry::get_kind(uint32_t handle) const {
+  const uint32_t slot_idx = handle & BODY_HANDLE_INDEX_MASK;
+  if (slot_idx >= slots.size()) {
+    return std::nullopt;
+  }
+
+  const Slot &slot = slots[slot_idx];
+  if (!slot.alive || slot.generation != (handle >> BODY_HANDLE_INDEX_BITS)) {
+    return std::nullopt;
+  }
+
+  return slot.kind;
+}
+
+BodyRegistry::KindStore &BodyRegistry::get_store(BodyKind kind) {
+  return stores[static_cast<size_t>(kind)];
+}
+
+const BodyRegistry::KindStore &BodyRegistry::get_store(BodyKind kind) const {
+  return stores[static_cast<size_t>(kind)];
+}
+
+size_t BodyRegistry::size() const {
+  size_t total = 0;
+  for (const KindStore &store : stores) {
+    total += store.size();
+  }
+  return total;
+}
+
+std::vector<uint16_t> BodyRegistry::get_slot_generations() const {
+  std::vector<uint16_t> generations;
+  generations.reserve(slots.size());
+  for (const Slot &slot : slots) {
+    generations.push_back(slot.generation);
+  }
+  return generations;
+}
+
+const std::deque<uint32_t> &BodyRegistry::get_free_slots() const {
+  return free_slots;
+}
+
+void BodyRegistry::restore_slots(const std::vector<uint16_t> &generations,
+                                 const std::deque<uint32_t> &free_slot_list) {
+  clear();
+  slots.clear();
+  slots.reserve(generations.size());
+  for (uint16_t generation : generations) {
+    slots.push_back(Slot{0, generation, BodyKind::BALL, false});
+  }
+  free_slots = free_slot_list;
+}
+
+bool BodyRegistry::insert_at(uint32_t handle, BodyKind kind, b2BodyId body_id,
+                             Color color, b2Transform transform,
+                             b2Vec2 velocity) {
+  const uint32_t slot_idx = handle & BODY_HANDLE_INDEX_MASK;
+  if (slot_idx >= slots.size()) {
+    return false;
+  }
+
+  Slot &slot = slots[slot_idx];
+  if (slot.alive || slot.generation != (handle >> BODY_HANDLE_INDEX_BITS)) {
+    return false;
+  }
+
+  KindStore &store = stores[static_cast<size_t>(kind)];
+  slot.dense_idx = static_cast<uint32_t>(store.size());
+  slot.kind = kind;
+  slot.alive = true;
+  push_body(store, handle, body_id, color, transform, velocity);
+
+  return true;
+}
+
+void BodyRegistry::free_slot(uint32_t slot_idx) {
+  Slot &slot = slots[slot_idx];
+  slot.alive = false;
+  // The last generation retires the slot instead of wrapping around to ids
+  // handed out before.
+  if (slot.generation == BODY_HANDLE_GENERATION_MASK) {
+    return;
+  }
+  ++slot.generation;
+  free_slots.push_back(slot_idx);
+}
+
+bool BodyRegistry::is_retired(const Slot &slot) {
+  return !slot.alive && slot.generation == BODY_HANDLE_GENERATION_MASK;
+}
+
+uint32_t BodyRegistry::make_handle(uint32_t slot_idx, uint16_t generation) {
+  return (static_cast<uint32_t>(generation) << BODY_HANDLE_INDEX_BITS) |
+         slot_idx;
+}
+
+void BodyRegistry::push_body(KindStore &store, uint32_t handle,
+                             b2BodyId body_id, Color color,
+                             b2Transform transform, b2Vec2 velocity) {
+  store.body_ids.push_back(body_id);
+  store.colors.push_back(color);
+  store.transforms.push_back(transform);
+  store.velocities.push_back(velocity);
+  store.prev_transforms.push_back(transform);
+  store.handles.push_back(handle);
+}
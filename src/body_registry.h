@@ -0,0 +1,142 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_BODY_REGISTRY_H_
+#define SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_BODY_REGISTRY_H_
+
+// third party includes
+#include <box2d/box2d.h>
+#include <raylib.h>
+
+// standard library includes
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+enum class BodyKind : uint8_t { BALL = 0, OCTAGON = 1, TRAPEZOID = 2 };
+constexpr int BODY_KIND_COUNT = 3;
+
+// Names used by the Lua API, indexed by BodyKind.
+constexpr const char *BODY_KIND_NAMES[BODY_KIND_COUNT] = {"ball", "octagon",
+                                                          "trapezoid"};
+
+std::optional<BodyKind> body_kind_from_name(std::string_view name);
+
+// A handle is the integer id given to Lua. The low bits index a slot and the
+// high bits hold the slot's generation, so a stale id never resolves to a body
+// that reused the slot. Slot 0 at generation 0 is id 0, so the first bodies of
+// a fresh scene get the same small ids as before.
+constexpr uint32_t BODY_HANDLE_INDEX_BITS = 20;
+constexpr uint32_t BODY_HANDLE_INDEX_MASK = (1U << BODY_HANDLE_INDEX_BITS) - 1;
+constexpr uint32_t BODY_HANDLE_GENERATION_MASK =
+    (1U << (32 - BODY_HANDLE_INDEX_BITS)) - 1;
+constexpr uint32_t BODY_HANDLE_INVALID = 0xFFFFFFFF;
+// Most bodies alive at once. The last index is left out so no handle can be
+// BODY_HANDLE_INVALID.
+constexpr uint32_t BODY_REGISTRY_CAPACITY = BODY_HANDLE_INDEX_MASK;
+
+// Box2D body user data holds "handle + 1" so static bodies (null user data)
+// can't be mistaken for handle 0.
+inline void *body_handle_to_user_data(uint32_t handle) {
+  return reinterpret_cast<void *>(static_cast<uintptr_t>(handle) + 1);
+}
+
+inline std::optional<uint32_t> body_handle_from_user_data(void *user_data) {
+  if (user_data == nullptr) {
+    return std::nullopt;
+  }
+  return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(user_data) - 1);
+}
+
+// Generational slot map holding every dynamic body of the 2D scene.
+//
+// Each kind has its own densely packed structure-of-arrays store so draw loops
+// iterate contiguous memory. Slots map handles to dense indices in O(1).
+class BodyRegistry {
+ public:
+  // Index "idx" of every vector describes the same body.
+  struct KindStore {
+    std::vector<b2BodyId> body_ids;
+    std::vector<Color> colors;
+    // Cached from Box2D's body move events after every step.
+    std::vector<b2Transform> transforms;
+    std::vector<b2Vec2> velocities;
+    // Transform before the most recent fixed step, used for interpolation.
+    std::vector<b2Transform> prev_transforms;
+    std::vector<uint32_t> handles;
+
+    size_t size() const;
+  };
+
+  BodyRegistry();
+
+  // Returns BODY_HANDLE_INVALID if every slot is in use.
+  uint32_t insert(BodyKind kind, b2BodyId body_id, Color color,
+                  b2Transform transform, b2Vec2 velocity);
+  // Returns false if "handle" isn't a live body of "kind".
+  bool erase(uint32_t handle, BodyKind kind);
+  // Erases every body. Handles of erased bodies never resolve again, each
+  // slot retires once its generations run out.
+  void clear();
+
+  // Dense index into "get_store(kind)" of a live body.
+  std::optional<uint32_t> find(uint32_t handle, BodyKind kind) const;
+  std::optional<BodyKind> get_kind(uint32_t handle) const;
+
+  KindStore &get_store(BodyKind kind);
+  const KindStore &get_store(BodyKind kind) const;
+
+  size_t size() const;
+
+  // Snapshot support. "restore_slots(...)" drops every body and recreates the
+  // slot table, "insert_at(...)" then brings bodies back under their original
+  // handles.
+  std::vector<uint16_t> get_slot_generations() const;
+  const std::deque<uint32_t> &get_free_slots() const;
+  void restore_slots(const std::vector<uint16_t> &generations,
+                     const std::deque<uint32_t> &free_slot_list);
+  // Returns false if the handle's slot is out of range, live, or has a
+  // different generation.
+  bool insert_at(uint32_t handle, BodyKind kind, b2BodyId body_id,
+                 Color color, b2Transform transform, b2Vec2 velocity);
+
+ private:
+  struct Slot {
+    uint32_t dense_idx;
+    uint16_t generation;
+    BodyKind kind;
+    bool alive;
+  };
+
+  std::array<KindStore, BODY_KIND_COUNT> stores;
+  // Slots freed at the last generation are retired, neither alive nor in
+  // "free_slots", so a handle never resolves twice.
+  std::vector<Slot> slots;
+  // FIFO so churn spreads generation bumps over many slots.
+  std::deque<uint32_t> free_slots;
+
+  static uint32_t make_handle(uint32_t slot_idx, uint16_t generation);
+  // Kills the slot's body and bumps its generation, or retires it.
+  void free_slot(uint32_t slot_idx);
+  static bool is_retired(const Slot &slot);
+  void push_body(KindStore &store, uint32_t handle, b2BodyId body_id,
+                 Color color, b2Transform transform, b2Vec2 velocity);
+};
+
+#endif
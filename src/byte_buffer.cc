@@ -0,0 +1,43 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "byte_buffer.h"
+
+// standard library includes
+#include <fstream>
+#include <iterator>
+
+bool write_bytes_to_file(const std::string &path,
+                         const std::vector<uint8_t> &bytes) {
+  std::ofstream ofs(path, std::ios_base::out | std::ios_base::trunc |
+                              std::ios_base::binary);
+  if (!ofs.good()) {
+    return false;
+  }
+  ofs.write(reinterpret_cast<const char *>(bytes.data()),
+            static_cast<std::streamsize>(bytes.size()));
+  return ofs.good();
+}
+
+bool read_bytes_from_file(const std::string &path, std::vector<uint8_t> *out) {
+  std::ifstream ifs(path, std::ios_base::in | std::ios_base::binary);
+  if (!ifs.good()) {
+    return false;
+  }
+  out->assign(std::istreambuf_iterator<char>(ifs),
+              std::istreambuf_iterator<char>());
+  return !ifs.bad();
+}
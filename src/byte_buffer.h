@@ -0,0 +1,80 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_BYTE_BUFFER_H_
+#define SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_BYTE_BUFFER_H_
+
+// standard library includes
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Appends plain values to a byte vector in host byte order (little endian on
+// every platform we build for).
+class ByteWriter {
+ public:
+  explicit ByteWriter(std::vector<uint8_t> *out) : out(out) {}
+
+  template <typename T>
+  void write(const T &value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    const size_t offset = out->size();
+    out->resize(offset + sizeof(T));
+    std::memcpy(out->data() + offset, &value, sizeof(T));
+  }
+
+ private:
+  std::vector<uint8_t> *out;
+};
+
+// Reads values written by ByteWriter. Every read returns false once the data
+// runs out, so callers can check once after a group of reads.
+class ByteReader {
+ public:
+  ByteReader(const uint8_t *data, size_t size)
+      : data(data), size(size), offset(0), ok(true) {}
+
+  template <typename T>
+  bool read(T *value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    if (!ok || size - offset < sizeof(T)) {
+      ok = false;
+      return false;
+    }
+    std::memcpy(value, data + offset, sizeof(T));
+    offset += sizeof(T);
+    return true;
+  }
+
+  bool is_ok() const { return ok; }
+  bool at_end() const { return offset == size; }
+
+ private:
+  const uint8_t *data;
+  size_t size;
+  size_t offset;
+  bool ok;
+};
+
+// Whole file helpers, return false on any I/O error.
+bool write_bytes_to_file(const std::string &path,
+                         const std::vector<uint8_t> &bytes);
+bool read_bytes_from_file(const std::string &path, std::vector<uint8_t> *out);
+
+#endif
@@ -0,0 +1,215 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "input_recording.h"
+
+// third party includes
+#include <raylib.h>
+
+// standard library includes
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+void poll_input_frame(float dt, bool has_gamepad, InputFrame *out) {
+  out->dt = dt;
+  out->keys.clear();
+  for (int key = GetKeyPressed(); key != 0; key = GetKeyPressed()) {
+    out->keys.push_back(key);
+  }
+
+  out->has_gamepad = has_gamepad;
+  out->gamepad_buttons = 0;
+  out->gamepad_axes.clear();
+  if (has_gamepad) {
+    for (int idx = 0; idx < INPUT_GAMEPAD_BUTTON_COUNT; ++idx) {
+      if (IsGamepadButtonPressed(0, idx)) {
+        out->gamepad_buttons |= 1U << idx;
+      }
+    }
+    const int axis_count = GetGamepadAxisCount(0);
+    for (int idx = 0; idx < axis_count; ++idx) {
+      out->gamepad_axes.push_back(GetGamepadAxisMovement(0, idx));
+    }
+  }
+}
+
+InputRecorder::InputRecorder()
+    : snapshot(), frame_data(), seed(0), frame_count(0), active(false) {}
+
+void InputRecorder::begin(uint32_t seed, std::vector<uint8_t> snapshot) {
+  this->snapshot = std::move(snapshot);
+  this->seed = seed;
+  frame_data.clear();
+  frame_count = 0;
+  active = true;
+}
+
+void InputRecorder::record(const InputFrame &frame) {
+  if (!active) {
+    return;
+  }
+
+  // Counts are stored as u8, anything past 255 entries is dropped.
+  ByteWriter writer(&frame_data);
+  writer.write(frame.dt);
+  const uint8_t key_count =
+      static_cast<uint8_t>(std::min<size_t>(frame.keys.size(), 255));
+  writer.write(key_count);
+  for (uint8_t idx = 0; idx < key_count; ++idx) {
+    writer.write(static_cast<uint16_t>(frame.keys[idx]));
+  }
+  writer.write(static_cast<uint8_t>(frame.has_gamepad ? 1 : 0));
+  if (frame.has_gamepad) {
+    const uint8_t axis_count =
+        static_cast<uint8_t>(std::min<size_t>(frame.gamepad_axes.size(), 255));
+    writer.write(frame.gamepad_buttons);
+    writer.write(axis_count);
+    for (uint8_t idx = 0; idx < axis_count; ++idx) {
+      writer.write(frame.gamepad_axes[idx]);
+    }
+  }
+  ++frame_count;
+}
+
+bool InputRecorder::finish(const std::string &path) {
+  if (!active) {
+    return false;
+  }
+  active = false;
+
+  std::vector<uint8_t> bytes;
+  bytes.reserve(snapshot.size() + frame_data.size() + 20);
+  ByteWriter writer(&bytes);
+  writer.write(INPUT_RECORDING_MAGIC);
+  writer.write(INPUT_RECORDING_VERSION);
+  writer.write(seed);
+  writer.write(static_cast<uint32_t>(snapshot.size()));
+  bytes.insert(bytes.end(), snapshot.begin(), snapshot.end());
+  writer.write(frame_count);
+  bytes.insert(bytes.end(), frame_data.begin(), frame_data.end());
+
+  snapshot.clear();
+  frame_data.clear();
+  return write_bytes_to_file(path, bytes);
+}
+
+void InputRecorder::cancel() {
+  active = false;
+  snapshot.clear();
+  frame_data.clear();
+}
+
+bool InputRecorder::is_active() const { return active; }
+
+uint32_t InputRecorder::get_frame_count() const { return frame_count; }
+
+InputReplayer::InputReplayer()
+    : data(),
+      snapshot(),
+      reader(nullptr, 0),
+      seed(0),
+      frames_left(0),
+      active(false) {}
+
+bool InputReplayer::load(const std::string &path) {
+  stop();
+  if (!read_bytes_from_file(path, &data)) {
+    return false;
+  }
+
+  reader = ByteReader(data.data(), data.size());
+  uint32_t magic = 0;
+  uint16_t version = 0;
+  uint32_t snapshot_size = 0;
+  reader.read(&magic);
+  reader.read(&version);
+  reader.read(&seed);
+  reader.read(&snapshot_size);
+  if (!reader.is_ok() || magic != INPUT_RECORDING_MAGIC ||
+      version != INPUT_RECORDING_VERSION) {
+    data.clear();
+    return false;
+  }
+
+  snapshot.resize(snapshot_size <= data.size() ? snapshot_size : 0);
+  for (uint8_t &byte : snapshot) {
+    reader.read(&byte);
+  }
+  reader.read(&frames_left);
+  if (!reader.is_ok() || snapshot.size() != snapshot_size) {
+    data.clear();
+    snapshot.clear();
+    return false;
+  }
+
+  active = true;
+  return true;
+}
+
+bool InputReplayer::next(InputFrame *out) {
+  if (!active || frames_left == 0) {
+    return false;
+  }
+
+  uint8_t count = 0;
+  uint8_t has_gamepad = 0;
+  reader.read(&out->dt);
+  reader.read(&count);
+  out->keys.clear();
+  for (uint8_t idx = 0; idx < count; ++idx) {
+    uint16_t key = 0;
+    reader.read(&key);
+    out->keys.push_back(key);
+  }
+  reader.read(&has_gamepad);
+  out->has_gamepad = has_gamepad != 0;
+  out->gamepad_buttons = 0;
+  out->gamepad_axes.clear();
+  if (out->has_gamepad) {
+    reader.read(&out->gamepad_buttons);
+    reader.read(&count);
+    for (uint8_t idx = 0; idx < count; ++idx) {
+      float axis = 0.0F;
+      reader.read(&axis);
+      out->gamepad_axes.push_back(axis);
+    }
+  }
+
+  // A NaN or negative dt would poison the scene's step accumulator.
+  if (!reader.is_ok() || !std::isfinite(out->dt) || out->dt < 0.0F) {
+    stop();
+    return false;
+  }
+  --frames_left;
+  return true;
+}
+
+void InputReplayer::stop() {
+  active = false;
+  frames_left = 0;
+  data.clear();
+  snapshot.clear();
+  reader = ByteReader(nullptr, 0);
+}
+
+bool InputReplayer::is_active() const { return active; }
+
+uint32_t InputReplayer::get_seed() const { return seed; }
+
+const std::vector<uint8_t> &InputReplayer::get_snapshot() const {
+  return snapshot;
+}
@@ -0,0 +1,100 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_INPUT_RECORDING_H_
+#define SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_INPUT_RECORDING_H_
+
+#include "byte_buffer.h"
+
+// standard library includes
+#include <cstdint>
+#include <string>
+#include <vector>
+
+constexpr uint32_t INPUT_RECORDING_MAGIC = 0x594C5052;  // "RPLY"
+constexpr uint16_t INPUT_RECORDING_VERSION = 1;
+// Only the first 32 gamepad buttons are polled, see "poll_input_frame(...)".
+constexpr int INPUT_GAMEPAD_BUTTON_COUNT = 32;
+
+// Input consumed by one "TwoDimWorldScene::update" call. Reused between frames
+// so polling doesn't allocate once the vectors have grown.
+struct InputFrame {
+  float dt;
+  // In the order returned by "GetKeyPressed()".
+  std::vector<int> keys;
+  // Bit "n" is set if gamepad button "n" was pressed this frame.
+  uint32_t gamepad_buttons;
+  std::vector<float> gamepad_axes;
+  bool has_gamepad;
+};
+
+// Fills "out" from raylib's input state. Gamepad 0 is only polled if
+// "has_gamepad" is true.
+void poll_input_frame(float dt, bool has_gamepad, InputFrame *out);
+
+// Appends frames to an in-memory buffer until "finish(...)" writes the file.
+//
+// File layout: magic, version, RNG seed, world snapshot (size prefixed), frame
+// count, then per frame: dt, key count and u16 keys, gamepad flag, and if set
+// the button bits, axis count and axis values.
+class InputRecorder {
+ public:
+  InputRecorder();
+
+  // "snapshot" is the world state the first recorded frame starts from.
+  void begin(uint32_t seed, std::vector<uint8_t> snapshot);
+  void record(const InputFrame &frame);
+  // Writes the recording to "path" and stops recording.
+  bool finish(const std::string &path);
+  void cancel();
+
+  bool is_active() const;
+  uint32_t get_frame_count() const;
+
+ private:
+  std::vector<uint8_t> snapshot;
+  std::vector<uint8_t> frame_data;
+  uint32_t seed;
+  uint32_t frame_count;
+  bool active;
+};
+
+// Feeds back frames from a file written by InputRecorder.
+class InputReplayer {
+ public:
+  InputReplayer();
+
+  // Returns false and stays inactive if the file is missing or invalid.
+  bool load(const std::string &path);
+  // Returns false once every frame was consumed or if the data is corrupt,
+  // including a non-finite or negative dt.
+  bool next(InputFrame *out);
+  void stop();
+
+  bool is_active() const;
+  uint32_t get_seed() const;
+  const std::vector<uint8_t> &get_snapshot() const;
+
+ private:
+  std::vector<uint8_t> data;
+  std::vector<uint8_t> snapshot;
+  ByteReader reader;
+  uint32_t seed;
+  uint32_t frames_left;
+  bool active;
+};
+
+#endif
@@ -0,0 +1,177 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "instanced_renderer.h"
+
+// third party includes
+#include <raymath.h>
+#include <rlgl.h>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten/html5.h>
+#endif
+
+// standard library includes
+#include <print>
+
+// GLSL ES 1.00 is accepted by both WebGL1 and WebGL2. raylib binds
+// "vertexPosition" to location 0, which must not be an instanced attribute.
+static const char *INSTANCED_VS =
+    "#version 100\n"
+    "attribute vec2 vertexPosition;\n"
+    "attribute vec4 instanceTransform;\n"
+    "attribute vec4 instanceColor;\n"
+    "uniform mat4 mvp;\n"
+    "varying vec4 fragColor;\n"
+    "void main() {\n"
+    "  vec2 rotated = vec2(\n"
+    "      instanceTransform.z * vertexPosition.x -\n"
+    "          instanceTransform.w * vertexPosition.y,\n"
+    "      instanceTransform.w * vertexPosition.x +\n"
+    "          instanceTransform.z * vertexPosition.y);\n"
+    "  fragColor = instanceColor;\n"
+    "  gl_Position = mvp * vec4(instanceTransform.xy + rotated, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *INSTANCED_FS =
+    "#version 100\n"
+    "precision mediump float;\n"
+    "varying vec4 fragColor;\n"
+    "void main() {\n"
+    "  gl_FragColor = fragColor;\n"
+    "}\n";
+
+InstancedShapeRenderer::InstancedShapeRenderer()
+    : meshes(),
+      shader_id(0),
+      mvp_loc(-1),
+      vertex_loc(-1),
+      transform_loc(-1),
+      color_loc(-1),
+      supported(false) {
+  const int version = rlGetVersion();
+  if (version == RL_OPENGL_ES_30) {
+    supported = true;
+  } else if (version == RL_OPENGL_ES_20) {
+#ifdef __EMSCRIPTEN__
+    supported = emscripten_webgl_enable_extension(
+        emscripten_webgl_get_current_context(), "ANGLE_instanced_arrays");
+#endif
+  }
+
+  if (!supported) {
+    std::println(stdout,
+                 "WARNING: Instanced rendering not supported, using fallback.");
+    return;
+  }
+
+  shader_id = rlLoadShaderCode(INSTANCED_VS, INSTANCED_FS);
+  mvp_loc = rlGetLocationUniform(shader_id, "mvp");
+  vertex_loc = rlGetLocationAttrib(shader_id, "vertexPosition");
+  transform_loc = rlGetLocationAttrib(shader_id, "instanceTransform");
+  color_loc = rlGetLocationAttrib(shader_id, "instanceColor");
+
+  if (shader_id == 0 || vertex_loc < 0 || transform_loc < 0 || color_loc < 0) {
+    std::println(stdout,
+                 "WARNING: Failed to load instancing shader, using fallback.");
+    supported = false;
+  }
+}
+
+InstancedShapeRenderer::~InstancedShapeRenderer() {
+  for (const Mesh &mesh : meshes) {
+    rlUnloadVertexBuffer(mesh.vertex_vbo);
+    if (mesh.instance_vbo != 0) {
+      rlUnloadVertexBuffer(mesh.instance_vbo);
+    }
+  }
+  if (shader_id != 0) {
+    rlUnloadShaderProgram(shader_id);
+  }
+}
+
+bool InstancedShapeRenderer::is_supported() const { return supported; }
+
+uint32_t InstancedShapeRenderer::add_mesh(
+    const std::vector<Vector2> &vertices) {
+  Mesh mesh{0, static_cast<int>(vertices.size()), 0, 0};
+  if (supported) {
+    mesh.vertex_vbo =
+        rlLoadVertexBuffer(vertices.data(),
+                           static_cast<int>(vertices.size() * sizeof(Vector2)),
+                           false);
+  }
+  meshes.push_back(mesh);
+  return static_cast<uint32_t>(meshes.size() - 1);
+}
+
+void InstancedShapeRenderer::draw(uint32_t mesh_idx,
+                                  const ShapeInstance *instances,
+                                  size_t count) {
+  if (!supported || count == 0 || mesh_idx >= meshes.size()) {
+    return;
+  }
+
+  Mesh &mesh = meshes[mesh_idx];
+  const int bytes = static_cast<int>(count * sizeof(ShapeInstance));
+  if (count > mesh.instance_capacity) {
+    // Grow geometrically so a steadily growing scene rarely reallocates.
+    if (mesh.instance_vbo != 0) {
+      rlUnloadVertexBuffer(mesh.instance_vbo);
+    }
+    mesh.instance_capacity = count * 2;
+    mesh.instance_vbo = rlLoadVertexBuffer(
+        nullptr,
+        static_cast<int>(mesh.instance_capacity * sizeof(ShapeInstance)),
+        true);
+  }
+
+  // Keep draw order, anything batched so far goes first.
+  rlDrawRenderBatchActive();
+
+  rlEnableShader(shader_id);
+  rlSetUniformMatrix(mvp_loc, MatrixMultiply(rlGetMatrixModelview(),
+                                             rlGetMatrixProjection()));
+  rlDisableBackfaceCulling();
+
+  rlEnableVertexBuffer(mesh.vertex_vbo);
+  rlSetVertexAttribute(vertex_loc, 2, RL_FLOAT, false, sizeof(Vector2), 0);
+  rlEnableVertexAttribute(vertex_loc);
+
+  rlEnableVertexBuffer(mesh.instance_vbo);
+  rlUpdateVertexBuffer(mesh.instance_vbo, instances, bytes, 0);
+  rlSetVertexAttribute(transform_loc, 4, RL_FLOAT, false,
+                       sizeof(ShapeInstance), 0);
+  rlEnableVertexAttribute(transform_loc);
+  rlSetVertexAttributeDivisor(transform_loc, 1);
+  rlSetVertexAttribute(color_loc, 4, RL_UNSIGNED_BYTE, true,
+                       sizeof(ShapeInstance), offsetof(ShapeInstance, color));
+  rlEnableVertexAttribute(color_loc);
+  rlSetVertexAttributeDivisor(color_loc, 1);
+
+  rlDrawVertexArrayInstanced(0, mesh.vertex_count, static_cast<int>(count));
+
+  // Divisors are sticky, reset them before raylib reuses these locations.
+  rlSetVertexAttributeDivisor(transform_loc, 0);
+  rlSetVertexAttributeDivisor(color_loc, 0);
+  rlDisableVertexAttribute(transform_loc);
+  rlDisableVertexAttribute(color_loc);
+  rlDisableVertexAttribute(vertex_loc);
+  rlDisableVertexBuffer();
+
+  rlEnableBackfaceCulling();
+  rlDisableShader();
+}
@@ -0,0 +1,82 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_INSTANCED_RENDERER_H_
+#define SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_INSTANCED_RENDERER_H_
+
+// third party includes
+#include <raylib.h>
+
+// standard library includes
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Segments of the circle mesh, same as raylib's "DrawCircle".
+constexpr int INSTANCED_CIRCLE_SEGMENTS = 36;
+
+// Per-instance record uploaded every frame. Position is in pixels, "cos" and
+// "sin" are the body's rotation.
+struct ShapeInstance {
+  float x;
+  float y;
+  float cos;
+  float sin;
+  Color color;
+};
+
+// Draws many copies of a mesh with one instanced draw call per mesh.
+//
+// Needs WebGL2 or WebGL1 with "ANGLE_instanced_arrays", check "is_supported()"
+// and fall back to raylib's shape functions if it returns false.
+class InstancedShapeRenderer {
+ public:
+  InstancedShapeRenderer();
+  ~InstancedShapeRenderer();
+
+  // Disable copy and move, owns GPU resources.
+  InstancedShapeRenderer(const InstancedShapeRenderer &) = delete;
+  InstancedShapeRenderer &operator=(const InstancedShapeRenderer &) = delete;
+  InstancedShapeRenderer(InstancedShapeRenderer &&) = delete;
+  InstancedShapeRenderer &operator=(InstancedShapeRenderer &&) = delete;
+
+  bool is_supported() const;
+
+  // "vertices" is a triangle list in pixels relative to the body's origin.
+  // Returns the mesh index to pass to "draw(...)".
+  uint32_t add_mesh(const std::vector<Vector2> &vertices);
+
+  // Flushes raylib's batch first so earlier draws stay underneath.
+  void draw(uint32_t mesh_idx, const ShapeInstance *instances, size_t count);
+
+ private:
+  struct Mesh {
+    unsigned int vertex_vbo;
+    int vertex_count;
+    unsigned int instance_vbo;
+    size_t instance_capacity;
+  };
+
+  std::vector<Mesh> meshes;
+  unsigned int shader_id;
+  int mvp_loc;
+  int vertex_loc;
+  int transform_loc;
+  int color_loc;
+  bool supported;
+};
+
+#endif
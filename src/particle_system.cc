@@ -0,0 +1,186 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+
+#include "particle_system.h"
+
+// standard library includes
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+ParticleParams default_particle_params() {
+  return ParticleParams{b2Vec2{0.0F, 0.0F},
+                        3.0F,
+                        -std::numbers::pi_v<float> / 2.0F,
+                        2.0F * std::numbers::pi_v<float>,
+                        1.0F,
+                        Color{255, 200, 0, 255}};
+}
+
+ParticleSystem::ParticleSystem()
+    : pos_x(),
+      pos_y(),
+      vel_x(),
+      vel_y(),
+      lives(),
+      inv_max_lives(),
+      colors(),
+      emitters(),
+      emitter_idx_counter(0),
+      rand_e(),
+      real_dist() {}
+
+size_t ParticleSystem::emit(b2Vec2 pos, size_t count,
+                            const ParticleParams &params) {
+  if (params.life <= 0.0F) {
+    return 0;
+  }
+  count = std::min(count, PARTICLE_MAX_COUNT - pos_x.size());
+
+  const float inv_life = 1.0F / params.life;
+  for (size_t idx = 0; idx < count; ++idx) {
+    const float angle =
+        params.angle + (real_dist(rand_e) - 0.5F) * params.spread;
+    const float speed = params.speed * (0.5F + 0.5F * real_dist(rand_e));
+    pos_x.push_back(pos.x);
+    pos_y.push_back(pos.y);
+    vel_x.push_back(params.velocity.x + std::cos(angle) * speed);
+    vel_y.push_back(params.velocity.y + std::sin(angle) * speed);
+    lives.push_back(params.life);
+    inv_max_lives.push_back(inv_life);
+    colors.push_back(params.color);
+  }
+
+  return count;
+}
+
+uint32_t ParticleSystem::create_emitter(b2Vec2 pos, float rate,
+                                        const ParticleParams &params) {
+  const uint32_t id = emitter_idx_counter++;
+  rate = std::isfinite(rate) ? std::clamp(rate, 0.0F, PARTICLE_MAX_RATE) : 0.0F;
+  emitters.insert({id, Emitter{pos, rate, params, 0.0F}});
+  return id;
+}
+
+bool ParticleSystem::set_emitter_pos(uint32_t id, b2Vec2 pos) {
+  if (auto iter = emitters.find(id); iter != emitters.end()) {
+    iter->second.pos = pos;
+    return true;
+  }
+  return false;
+}
+
+bool ParticleSystem::destroy_emitter(uint32_t id) {
+  return emitters.erase(id) != 0;
+}
+
+void ParticleSystem::update(float dt, b2Vec2 gravity) {
+  for (auto &[id, emitter] : emitters) {
+    emitter.accumulator += emitter.rate * dt;
+    const float whole = std::floor(emitter.accumulator);
+    emitter.accumulator -= whole;
+    // Bounded before the cast, a huge "dt" can't overflow "size_t".
+    emit(emitter.pos,
+         static_cast<size_t>(
+             std::min(whole, static_cast<float>(PARTICLE_MAX_COUNT))),
+         emitter.params);
+  }
+
+  // Plain loops over raw arrays without aliasing between them, so the
+  // compiler vectorizes them (e.g. with "-msimd128").
+  const size_t count = pos_x.size();
+  float *x = pos_x.data();
+  float *y = pos_y.data();
+  float *vx = vel_x.data();
+  float *vy = vel_y.data();
+  float *life = lives.data();
+  const float gx = gravity.x * dt;
+  const float gy = gravity.y * dt;
+  for (size_t idx = 0; idx < count; ++idx) {
+    vx[idx] += gx;
+    vy[idx] += gy;
+  }
+  for (size_t idx = 0; idx < count; ++idx) {
+    x[idx] += vx[idx] * dt;
+    y[idx] += vy[idx] * dt;
+  }
+  for (size_t idx = 0; idx < count; ++idx) {
+    life[idx] -= dt;
+  }
+
+  remove_dead();
+}
+
+void ParticleSystem::clear() {
+  pos_x.clear();
+  pos_y.clear();
+  vel_x.clear();
+  vel_y.clear();
+  lives.clear();
+  inv_max_lives.clear();
+  colors.clear();
+  emitters.clear();
+}
+
+void ParticleSystem::fill_instances(b2AABB view, float pixel_ratio,
+                                    std::vector<ShapeInstance> *out) const {
+  for (size_t idx = 0; idx < pos_x.size(); ++idx) {
+    if (pos_x[idx] < view.lowerBound.x || pos_x[idx] > view.upperBound.x ||
+        pos_y[idx] < view.lowerBound.y || pos_y[idx] > view.upperBound.y) {
+      continue;
+    }
+    Color color = colors[idx];
+    color.a = static_cast<unsigned char>(
+        static_cast<float>(color.a) *
+        std::clamp(lives[idx] * inv_max_lives[idx], 0.0F, 1.0F));
+    out->push_back(ShapeInstance{pos_x[idx] * pixel_ratio,
+                                 pos_y[idx] * pixel_ratio, 1.0F, 0.0F, color});
+  }
+}
+
+size_t ParticleSystem::size() const { return pos_x.size(); }
+
+size_t ParticleSystem::get_emitter_count() const { return emitters.size(); }
+
+void ParticleSystem::remove_dead() {
+  size_t idx = 0;
+  size_t count = lives.size();
+  while (idx < count) {
+    if (lives[idx] > 0.0F) {
+      ++idx;
+      continue;
+    }
+
+    // Swap with the last live candidate to keep the arrays dense.
+    --count;
+    pos_x[idx] = pos_x[count];
+    pos_y[idx] = pos_y[count];
+    vel_x[idx] = vel_x[count];
+    vel_y[idx] = vel_y[count];
+    lives[idx] = lives[count];
+    inv_max_lives[idx] = inv_max_lives[count];
+    colors[idx] = colors[count];
+  }
+
+  pos_x.resize(count);
+  pos_y.resize(count);
+  vel_x.resize(count);
+  vel_y.resize(count);
+  lives.resize(count);
+  inv_max_lives.resize(count);
+  colors.resize(count);
+}
@@ -0,0 +1,113 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+
+#ifndef SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_PARTICLE_SYSTEM_H_
+#define SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_PARTICLE_SYSTEM_H_
+
+#include "instanced_renderer.h"
+
+// third party includes
+#include <box2d/box2d.h>
+#include <raylib.h>
+
+// standard library includes
+#include <cstdint>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+// Live particles beyond this are dropped instead of emitted.
+constexpr size_t PARTICLE_MAX_COUNT = 1 << 16;
+// Most particles per second of one emitter, a full system's worth.
+constexpr float PARTICLE_MAX_RATE = static_cast<float>(PARTICLE_MAX_COUNT);
+// Particles are squares of this half size in Box2D units.
+constexpr float PARTICLE_HALF_SIZE = 0.025F;
+
+// How "ParticleSystem::emit(...)" launches each particle. The particle's
+// velocity is "velocity" plus a random speed of 50-100% of "speed" in a
+// random direction within "spread" radians centered on "angle".
+struct ParticleParams {
+  b2Vec2 velocity;
+  float speed;
+  // Radians, 0 is +x, -pi/2 is up on screen.
+  float angle;
+  float spread;
+  // Seconds, particles fade out over their life.
+  float life;
+  Color color;
+};
+
+ParticleParams default_particle_params();
+
+// Purely cosmetic particles: no collisions, no Box2D bodies. Storage is
+// structure-of-arrays so the per-frame integration is a few flat loops the
+// compiler can vectorize. Dead particles are swap-removed, order isn't kept.
+class ParticleSystem {
+ public:
+  ParticleSystem();
+
+  // Returns how many were emitted, fewer than "count" at PARTICLE_MAX_COUNT.
+  size_t emit(b2Vec2 pos, size_t count, const ParticleParams &params);
+
+  // Emitters emit "rate" particles per second until destroyed. "rate" is
+  // clamped to 0-PARTICLE_MAX_RATE, non-finite rates emit nothing.
+  uint32_t create_emitter(b2Vec2 pos, float rate,
+                          const ParticleParams &params);
+  bool set_emitter_pos(uint32_t id, b2Vec2 pos);
+  bool destroy_emitter(uint32_t id);
+
+  // Runs emitters, then integrates and ages every particle.
+  void update(float dt, b2Vec2 gravity);
+  void clear();
+
+  // Appends one instance per particle inside "view" (in Box2D units) to
+  // "out", positions scaled by "pixel_ratio".
+  void fill_instances(b2AABB view, float pixel_ratio,
+                      std::vector<ShapeInstance> *out) const;
+
+  size_t size() const;
+  size_t get_emitter_count() const;
+
+ private:
+  struct Emitter {
+    b2Vec2 pos;
+    float rate;
+    ParticleParams params;
+    // Fractional particles carried over to the next update.
+    float accumulator;
+  };
+
+  // Index "idx" of every vector describes the same particle.
+  std::vector<float> pos_x;
+  std::vector<float> pos_y;
+  std::vector<float> vel_x;
+  std::vector<float> vel_y;
+  // Seconds left.
+  std::vector<float> lives;
+  std::vector<float> inv_max_lives;
+  std::vector<Color> colors;
+
+  std::unordered_map<uint32_t, Emitter> emitters;
+  uint32_t emitter_idx_counter;
+  // Separate from the scene's RNG so effects don't change simulation results.
+  std::minstd_rand rand_e;
+  std::uniform_real_distribution<float> real_dist;
+
+  void remove_dead();
+};
+
+#endif
@@ -22,21 +22,27 @@ extern "C" {
 #include <lualib.h>
 }
 #include <lpeg_exported.h>
+#ifdef __EMSCRIPTEN__
 #ifndef NDEBUG
 #include <emscripten/console.h>
 #endif
 #include <emscripten/html5.h>
+#endif
 #include <imgui.h>
 #include <raylib.h>
 #include <rlImGui.h>
 
 // standard library includes
+#include <filesystem>
+#include <format>
 #include <fstream>
 #include <print>
 
 // local includes
 #include "2d_world_scene.h"
+#include "benchmark_scene.h"
 #include "script_edit_scene.h"
+#include "task_pool.h"
 
 Scene::Scene(SceneSystem *) {}
 Scene::~Scene() {}
@@ -46,9 +52,25 @@ std::optional<uint32_t> Scene::get_scene_id(SceneSystem *ctx) {
 }
 
 SceneSystem::SceneSystem()
-    : scene_stack(),
+    : time_point(std::chrono::steady_clock::now()),
+      scene_stack(),
+      sim_settings{true,
+                   DEFAULT_FIXED_STEP_RATE,
+                   DEFAULT_MAX_CATCHUP_STEPS,
+                   1,
+                   DEFAULT_MIN_SUBSTEPS,
+                   DEFAULT_MAX_SUBSTEPS,
+                   true,
+                   true,
+                   DEFAULT_BODY_POOL_SIZE,
+                   true,
+                   DEFAULT_TARGET_FPS},
       dt{1.0F, 1.0F, 1.0F, 1.0F, 1.0F, 1.0F, 1.0F, 1.0F, 1.0F, 1.0F},
       dt_idx(0),
+      busy_time(0.0F),
+      degrade_level(DegradeLevel::NONE),
+      governor_over_frames(0),
+      governor_under_frames(0),
       flags(),
       private_flags(),
       scene_type_counter(0) {
@@ -123,6 +145,19 @@ void SceneSystem::draw() {
         return std::make_unique<TwoDimWorldScene>(ctx);
       });
       std::println(stdout, "Pushed 2DWorldScene.");
+    } else {
+      ImGui::Text("Degrade level: %d (%s)", static_cast<int>(degrade_level),
+                  DEGRADE_LEVEL_NAMES[static_cast<int>(degrade_level)]);
+      const TwoDimWorldScene *scene =
+          static_cast<TwoDimWorldScene *>(get_top().value()->get());
+      for (int kind = 0; kind < BODY_KIND_COUNT; ++kind) {
+        const BodyPoolStats &stats =
+            scene->get_body_pool_stats(static_cast<BodyKind>(kind));
+        ImGui::Text("%s pool: %zu pooled, %zu peak live, %llu reused, %llu new",
+                    BODY_KIND_NAMES[kind], stats.pooled, stats.peak_live,
+                    static_cast<unsigned long long>(stats.reused),
+                    static_cast<unsigned long long>(stats.created));
+      }
     }
 
     ImGui::TextWrapped("scene_2d is a global table in 2DSimulation.");
@@ -179,7 +214,146 @@ void SceneSystem::draw() {
     ImGui::TextWrapped(
         "  scene_2d.settrapezoidcolor(id: integer, r: integer, g: integer, b: "
         "integer, alpha: optional integer)");
+    ImGui::TextWrapped(
+        "    set*pos and apply*impulse take effect right before the next "
+        "physics step, get*pos and get*vel return the old values until then.");
+    ImGui::TextWrapped(
+        "  scene_2d.spawn(kind: string, count: integer, params: optional "
+        "table) -> table of integers");
+    ImGui::TextWrapped(
+        "    kind is \"ball\", \"octagon\" or \"trapezoid\". params may "
+        "hold x, y, vx, vy, dx, dy (offset per body) and color {r, g, b, a}. "
+        "count can't exceed the bodies that can still be created.");
+    ImGui::TextWrapped(
+        "  scene_2d.setcamera(x: number, y: number, zoom: optional number)");
+    ImGui::TextWrapped(
+        "    x, y is the top-left corner of the view in Box2D units.");
+    ImGui::TextWrapped(
+        "  scene_2d.createsensor(x: number, y: number, half_w: number, half_h: "
+        "number) -> integer");
+    ImGui::TextWrapped("  scene_2d.destroysensor(id: integer) -> boolean");
+    ImGui::TextWrapped(
+        "  scene_2d.queryaabb(min_x: number, min_y: number, max_x: number, "
+        "max_y: number, out: optional table) -> table, integer");
+    ImGui::TextWrapped(
+        "  scene_2d.querycircle(x: number, y: number, radius: number, out: "
+        "optional table) -> table, integer");
+    ImGui::TextWrapped(
+        "  scene_2d.raycast(x1: number, y1: number, x2: number, y2: number, "
+        "out: optional table) -> table, integer");
+    ImGui::TextWrapped(
+        "    Queries fill \"out\" (or the reused \"scene_2d.query_result\") "
+        "with body ids, set \"out.n\" and return it with the count. raycast "
+        "orders ids nearest first. Numbers must be finite, queryaabb needs "
+        "min <= max and querycircle a radius above 0.");
+    ImGui::TextWrapped(
+        "  scene_2d.getpositions(kind: string, out: optional table) -> table, "
+        "integer");
+    ImGui::TextWrapped(
+        "  scene_2d.getvelocities(kind: string, out: optional table) -> "
+        "table, integer");
+    ImGui::TextWrapped(
+        "    Fill \"out\" with \"id, x, y\" of every body of a kind as one "
+        "flat array, set \"out.n\" to the body count and return it with the "
+        "count. Cheaper than a get*pos call per body.");
+    ImGui::TextWrapped("  scene_2d.body(id: integer) -> body or nil");
+    ImGui::TextWrapped(
+        "    Body userdata, \"scene_2d.create*(true)\" also returns one "
+        "instead of an id. Methods: id(), kind(), valid(), pos(), vel(), "
+        "setpos(x, y), impulse(x, y), color(r, g, b, a), destroy() and "
+        "data(). data() returns the body's own table for script state. An id "
+        "gives the same body (and table) for as long as the body lives. "
+        "After a reset or snapshot load, ids give new bodies with empty "
+        "tables.");
+    ImGui::TextWrapped("  scene_2d.savesnapshot(name: string) -> boolean");
+    ImGui::TextWrapped("  scene_2d.loadsnapshot(name: string) -> boolean");
+    ImGui::TextWrapped(
+        "    Snapshots hold every body and sensor and keep their ids. They are "
+        "stored in /snapshots and survive switching scenes. Lua tables are "
+        "not part of a snapshot.");
+    ImGui::TextWrapped("  scene_2d.setseed(seed: integer)");
+    ImGui::TextWrapped("  scene_2d.startrecording(name: string) -> boolean");
+    ImGui::TextWrapped("  scene_2d.stoprecording() -> boolean");
+    ImGui::TextWrapped("  scene_2d.startreplay(name: string) -> boolean");
+    ImGui::TextWrapped("  scene_2d.stopreplay()");
+    ImGui::TextWrapped("  scene_2d.isreplaying() -> boolean");
+    ImGui::TextWrapped(
+        "    Recordings hold a snapshot, the RNG seed and every frame's input "
+        "and dt. They start on the next update and are stored in "
+        "/recordings. While replaying, recorded input is used instead of the "
+        "keyboard and gamepad. Lua variables are not recorded, so a replay "
+        "only matches if the script's own state (tables of body ids, timers) "
+        "is the same as when recording started, e.g. in the same session "
+        "right after recording.");
+    ImGui::TextWrapped(
+        "  scene_2d.getpoolstats(kind: string) -> integer (pooled), integer "
+        "(peak live bodies), integer (reused), integer (newly created)");
+    ImGui::TextWrapped(
+        "    Destroyed bodies are disabled and kept for reuse by later "
+        "creates, up to the pool size in Settings.");
+    ImGui::TextWrapped(
+        "  scene_2d.setsubsteps(min: integer, max: integer) -> nil");
+    ImGui::TextWrapped(
+        "    Bounds (1-16) of the Box2D substeps per step. The count rises "
+        "while bodies move and more for piles, falls when the scene is calm "
+        "or physics runs over budget. Moving the substep sliders in Settings "
+        "replaces these bounds. Bodies moving more than their radius (0.1) "
+        "per step are made bullets instead.");
+    ImGui::TextWrapped(
+        "  scene_2d.getsubsteps() -> integer (current), integer (min), "
+        "integer (max)");
+    ImGui::TextWrapped("  scene_2d.reset() -> nil");
+    ImGui::TextWrapped(
+        "    Removes every body, sensor and particle and rewinds sensor ids "
+        "and the seeded RNG, keeping the ground, walls, terrain and "
+        "callbacks. Body ids from before the reset stay invalid. "
+        "scene_2d.init isn't called again.");
+    ImGui::TextWrapped(
+        "  scene_2d.getdegradelevel() -> integer (0-4), string (name)");
+    ImGui::TextWrapped(
+        "    Raised one level at a time while frames run over the target in "
+        "Settings: 1 drops interpolation, 2 halves physics substeps, 3 calls "
+        "scene_2d.update every other update (with the summed dt), 4 skips "
+        "drawing off-screen bodies. Levels 2 and 3 are ignored while "
+        "recording or replaying input.");
+    ImGui::TextWrapped("  scene_2d.loadterrain(name: string) -> boolean");
+    ImGui::TextWrapped(
+        "    Loads /terrain/<name>.terrain, replacing the ground and walls. "
+        "Each line is \"chunk_size <size>\" (0.25-1024), \"friction <value>\", "
+        "\"restitution <value>\", \"chain <x0> <y0> <x1> <y1> ...\" (open, "
+        "solid from above when running left to right) or \"loop <x0> <y0> "
+        "...\" (closed, clockwise on screen). Only chunks near the camera or a "
+        "body, or ahead of a moving body, are added to the physics world.");
+    ImGui::TextWrapped(
+        "  scene_2d.getterraininfo() -> integer (loaded chunks), integer "
+        "(total chunks)");
+    ImGui::TextWrapped(
+        "  scene_2d.emitparticles(x: number, y: number, count: integer, "
+        "params: table (optional)) -> integer (emitted)");
+    ImGui::TextWrapped(
+        "    Cosmetic particles without collisions, cheaper than bodies. "
+        "\"params\" may have vx, vy (base velocity), speed, angle, spread "
+        "(radians, particles fly at 50-100% of speed within spread around "
+        "angle), life (seconds) and color.");
+    ImGui::TextWrapped(
+        "  scene_2d.createemitter(x: number, y: number, rate: number, params: "
+        "table (optional)) -> integer (emitter id)");
+    ImGui::TextWrapped(
+        "    Emits \"rate\" (0-65536) particles per second until destroyed.");
+    ImGui::TextWrapped(
+        "  scene_2d.setemitterpos(id: integer, x: number, y: number) -> "
+        "boolean");
+    ImGui::TextWrapped("  scene_2d.destroyemitter(id: integer) -> boolean");
+    ImGui::TextWrapped("  scene_2d.getparticlecount() -> integer");
     ImGui::TextWrapped("  scene_2d.getpixelb2ratio() -> number");
+    ImGui::TextWrapped(
+        "\n\"scene_2d.contact_callback\" may be a function that is called once "
+        "per update with a table of this frame's events. \"begin_a[i]\" and "
+        "\"begin_b[i]\" for i up to \"begin_n\" are ids of bodies that started "
+        "touching (-1 for ground and walls). \"end_*\" is the same for bodies "
+        "that stopped touching. \"sensor_begin_a\"/\"sensor_end_a\" hold "
+        "sensor ids and \"sensor_begin_b\"/\"sensor_end_b\" the body ids "
+        "entering or leaving them. The table is reused between calls.");
 
     ImGui::EndTabItem();
   }
@@ -193,6 +367,7 @@ void SceneSystem::draw() {
     bool is_fullscreen = flags.test(0);
     ImGui::Checkbox("Fullscreen Enabled", &is_fullscreen);
     if (is_fullscreen != flags.test(0)) {
+#ifdef __EMSCRIPTEN__
       if (is_fullscreen) {
         if (emscripten_request_fullscreen("canvas", true) !=
             EMSCRIPTEN_RESULT_SUCCESS) {
@@ -203,6 +378,9 @@ void SceneSystem::draw() {
           is_fullscreen = true;
         }
       }
+#else
+      ToggleFullscreen();
+#endif
     }
     flags.set(0, is_fullscreen);
 
@@ -225,6 +403,63 @@ void SceneSystem::draw() {
     avg /= static_cast<float>(dt.size());
     ImGui::Text("Current FPS is: %0.1f", 1.0F / avg);
 
+    ImGui::Checkbox("Fixed Physics Timestep",
+                    &sim_settings.fixed_step_enabled);
+    ImGui::SliderInt("Physics Step Rate (Hz)", &sim_settings.fixed_step_rate,
+                     30, 240, "%d", ImGuiSliderFlags_AlwaysClamp);
+    ImGui::SliderInt("Max Catch-up Steps", &sim_settings.max_catchup_steps, 1,
+                     16, "%d", ImGuiSliderFlags_AlwaysClamp);
+
+    if (TaskPool::get_max_thread_count() > 1) {
+      ImGui::SliderInt("Physics Threads", &sim_settings.physics_thread_count,
+                       1, TaskPool::get_max_thread_count(), "%d",
+                       ImGuiSliderFlags_AlwaysClamp);
+      ImGui::TextWrapped(
+          "The thread count applies to the next 2D scene created, the "
+          "running one keeps its threads.");
+    } else {
+      ImGui::TextWrapped(
+          "Physics Threads: 1 (this build was made without thread support)");
+    }
+
+    ImGui::Checkbox("Frame Budget Governor", &sim_settings.governor_enabled);
+    ImGui::SliderInt("Target FPS", &sim_settings.target_fps, 20, 240, "%d",
+                     ImGuiSliderFlags_AlwaysClamp);
+    ImGui::Text("Degrade Level: %d (%s), busy %0.2f ms per frame",
+                static_cast<int>(degrade_level),
+                DEGRADE_LEVEL_NAMES[static_cast<int>(degrade_level)],
+                busy_time * 1000.0F);
+
+    ImGui::SliderInt("Min Physics Substeps", &sim_settings.min_substeps, 1,
+                     MAX_SUBSTEPS, "%d", ImGuiSliderFlags_AlwaysClamp);
+    ImGui::SliderInt("Max Physics Substeps", &sim_settings.max_substeps, 1,
+                     MAX_SUBSTEPS, "%d", ImGuiSliderFlags_AlwaysClamp);
+    if (sim_settings.max_substeps < sim_settings.min_substeps) {
+      sim_settings.max_substeps = sim_settings.min_substeps;
+    }
+
+    ImGui::Checkbox("Instanced Body Rendering",
+                    &sim_settings.instanced_rendering);
+    ImGui::Checkbox("Cull Off-screen Bodies", &sim_settings.cull_offscreen);
+    ImGui::SliderInt("Body Pool Size (per kind)", &sim_settings.body_pool_size,
+                     0, MAX_BODY_POOL_SIZE, "%d", ImGuiSliderFlags_AlwaysClamp);
+    ImGui::TextWrapped("The pool size applies to the next 2D scene created.");
+
+    ImGui::EndTabItem();
+  }
+  if (ImGui::BeginTabItem("Benchmark")) {
+    std::optional<uint32_t> top_id = get_top_scene_id();
+    if (!top_id.has_value() ||
+        top_id != get_scene_id_by_template<BenchmarkScene>()) {
+      clear_scenes();
+      push_scene([](SceneSystem *ctx) {
+        return std::make_unique<BenchmarkScene>(ctx);
+      });
+      std::println(stdout, "Pushed BenchmarkScene.");
+    } else {
+      static_cast<BenchmarkScene *>(get_top().value()->get())
+          ->draw_config_tab(this);
+    }
     ImGui::EndTabItem();
   }
   if (ImGui::BeginTabItem("ScriptEditor")) {
@@ -254,6 +489,8 @@ void SceneSystem::draw() {
     private_flags.reset(2);
     private_flags.flip(1);
   }
+
+  update_governor();
 }
 
 void SceneSystem::clear_scenes() {
@@ -275,6 +512,14 @@ SceneSystem::FlagsType &SceneSystem::get_flags() { return flags; }
 
 const SceneSystem::FlagsType &SceneSystem::get_flags() const { return flags; }
 
+SimSettings &SceneSystem::get_sim_settings() { return sim_settings; }
+
+const SimSettings &SceneSystem::get_sim_settings() const {
+  return sim_settings;
+}
+
+DegradeLevel SceneSystem::get_degrade_level() const { return degrade_level; }
+
 const std::deque<SceneSystem::SceneType> *SceneSystem::get_scene_stack() const {
   return &scene_stack;
 }
@@ -351,7 +596,11 @@ void SceneSystem::init_lua() {
     lua_close(lctx);
   });
 
-  EM_ASM(FS.mkdir('/preloaded'););
+  for (const char *dir :
+       {"/preloaded", "/snapshots", "/recordings", "/terrain"}) {
+    std::error_code err;
+    std::filesystem::create_directories(std::format("{}{}", FS_ROOT, dir), err);
+  }
 
   luaL_requiref(lua_ctx, LUA_GNAME, luaopen_base, 1);           // +1
   lua_pop(lua_ctx, 1);                                          // -1
@@ -375,19 +624,21 @@ void SceneSystem::init_lua() {
   lua_pop(lua_ctx, 1);                                          // -1
 
   // Set "package.path"
-  lua_getglobal(lua_ctx, "package");  // +1
-  lua_pushstring(lua_ctx, "path");    // +1
-  lua_pushstring(lua_ctx,
-                 "/preloaded/?/init.lua;/preloaded/?.lua;"
-                 "/assets_embed/?/init.lua;/assets_embed/?.lua;"
-                 "/?/init.lua;/?.lua");  // +1
-  lua_settable(lua_ctx, -3);             // -2
-  lua_pop(lua_ctx, 1);                   // -1
+  const std::string package_path = std::format(
+      "{0}/preloaded/?/init.lua;{0}/preloaded/?.lua;"
+      "{0}/assets_embed/?/init.lua;{0}/assets_embed/?.lua;"
+      "{0}/?/init.lua;{0}/?.lua",
+      FS_ROOT);
+  lua_getglobal(lua_ctx, "package");              // +1
+  lua_pushstring(lua_ctx, "path");                // +1
+  lua_pushstring(lua_ctx, package_path.c_str());  // +1
+  lua_settable(lua_ctx, -3);                      // -2
+  lua_pop(lua_ctx, 1);                            // -1
 
   lua_pushcfunction(lua_ctx, luaopen_lpeg);       // +1
   lua_setglobal(lua_ctx, "luaopen_lpeg_global");  // -1
 
-  std::ofstream lua_lpeg_of("/preloaded/lpeg.lua",
+  std::ofstream lua_lpeg_of(std::format("{}/preloaded/lpeg.lua", FS_ROOT),
                             std::ios_base::out | std::ios_base::trunc);
   lua_lpeg_of << "return luaopen_lpeg_global()";
   lua_lpeg_of.close();
@@ -428,6 +679,49 @@ void SceneSystem::init_lua() {
   }
 }
 
+void SceneSystem::update_governor() {
+  // "time_point" was taken at the start of this frame's "update()".
+  const float busy = std::chrono::duration<float>(
+                         std::chrono::steady_clock::now() - time_point)
+                         .count();
+  busy_time = busy_time * 0.9F + busy * 0.1F;
+
+  // Benchmarks measure the full-fidelity simulation.
+  std::optional<uint32_t> top_id = get_top_scene_id();
+  if (!sim_settings.governor_enabled || sim_settings.target_fps <= 0 ||
+      (top_id.has_value() &&
+       top_id == get_scene_id_by_template<BenchmarkScene>())) {
+    degrade_level = DegradeLevel::NONE;
+    governor_over_frames = 0;
+    governor_under_frames = 0;
+    return;
+  }
+
+  const float target = 1.0F / static_cast<float>(sim_settings.target_fps);
+  const int level = static_cast<int>(degrade_level);
+  if (busy_time > target * GOVERNOR_OVER_BUDGET) {
+    governor_under_frames = 0;
+    if (++governor_over_frames >= GOVERNOR_RAISE_FRAMES &&
+        level + 1 < DEGRADE_LEVEL_COUNT) {
+      degrade_level = static_cast<DegradeLevel>(level + 1);
+      governor_over_frames = 0;
+      std::println(stdout, "Degrade level raised to {} ({}).", level + 1,
+                   DEGRADE_LEVEL_NAMES[level + 1]);
+    }
+  } else if (busy_time < target * GOVERNOR_UNDER_BUDGET) {
+    governor_over_frames = 0;
+    if (++governor_under_frames >= GOVERNOR_LOWER_FRAMES && level > 0) {
+      degrade_level = static_cast<DegradeLevel>(level - 1);
+      governor_under_frames = 0;
+      std::println(stdout, "Degrade level lowered to {} ({}).", level - 1,
+                   DEGRADE_LEVEL_NAMES[level - 1]);
+    }
+  } else {
+    governor_over_frames = 0;
+    governor_under_frames = 0;
+  }
+}
+
 void SceneSystem::handle_actions() {
   while (!queued_actions.empty()) {
     switch (queued_actions.front().type) {
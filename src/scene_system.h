@@ -17,6 +17,7 @@
 #ifndef SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_SCENE_SYSTEM_H_
 #define SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_SCENE_SYSTEM_H_
 
+#include <array>
 #include <bitset>
 #include <chrono>
 #include <cstdint>
@@ -26,9 +27,81 @@
 #include <optional>
 #include <unordered_map>
 
+// Prefix of every path used for script and data files. The web build uses
+// Emscripten's in-memory filesystem, native builds use the working directory.
+#ifdef __EMSCRIPTEN__
+constexpr const char *FS_ROOT = "";
+#else
+constexpr const char *FS_ROOT = ".";
+#endif
+
+constexpr int DEFAULT_FIXED_STEP_RATE = 60;
+constexpr int DEFAULT_MAX_CATCHUP_STEPS = 4;
+constexpr int DEFAULT_MIN_SUBSTEPS = 2;
+constexpr int DEFAULT_MAX_SUBSTEPS = 8;
+constexpr int MAX_SUBSTEPS = 16;
+constexpr int DEFAULT_BODY_POOL_SIZE = 256;
+constexpr int MAX_BODY_POOL_SIZE = 4096;
+constexpr int DEFAULT_TARGET_FPS = 60;
+
+// Frame-budget governor levels, see "SceneSystem::update_governor(...)".
+// Each level keeps the degradations of the levels below it.
+enum class DegradeLevel : uint8_t {
+  NONE = 0,
+  // Draw bodies at the latest step instead of interpolating.
+  NO_INTERPOLATION = 1,
+  // Halve the adaptive physics substep count.
+  FEWER_SUBSTEPS = 2,
+  // Call "scene_2d.update" every GOVERNOR_LUA_INTERVAL updates.
+  THROTTLED_LUA = 3,
+  // Skip drawing off-screen bodies even if culling is off in Settings.
+  CULLED_DRAW = 4
+};
+constexpr int DEGRADE_LEVEL_COUNT = 5;
+constexpr const char *DEGRADE_LEVEL_NAMES[DEGRADE_LEVEL_COUNT] = {
+    "none", "no interpolation", "fewer substeps", "throttled lua",
+    "culled draw"};
+
+// Busy time (update and draw, not waiting on vsync) above this fraction of
+// the target frame time is over budget, below the lower one under budget.
+constexpr float GOVERNOR_OVER_BUDGET = 0.9F;
+constexpr float GOVERNOR_UNDER_BUDGET = 0.5F;
+// Consecutive frames over or under budget before changing the level. Going
+// back up is slower so the level doesn't flip back and forth.
+constexpr int GOVERNOR_RAISE_FRAMES = 30;
+constexpr int GOVERNOR_LOWER_FRAMES = 180;
+constexpr int GOVERNOR_LUA_INTERVAL = 2;
+
 // Forward declarations.
 class SceneSystem;
 
+// Simulation settings editable from the "Settings" tab. These live in
+// SceneSystem because the simulation scene is rebuilt on every tab switch.
+struct SimSettings {
+  // Step the physics world at a fixed rate instead of the frame's delta-time.
+  bool fixed_step_enabled;
+  // Fixed steps per second.
+  int fixed_step_rate;
+  // Upper bound on steps taken in one frame to catch up with wall-clock time.
+  int max_catchup_steps;
+  // Threads used by Box2D's solver, including the main thread.
+  int physics_thread_count;
+  // Bounds of the adaptive Box2D substep count, read when the 2D scene is
+  // created. Equal bounds give a fixed count.
+  int min_substeps;
+  int max_substeps;
+  // Draw dynamic bodies with one instanced draw call per shape kind.
+  bool instanced_rendering;
+  // Only draw bodies overlapping the visible area.
+  bool cull_offscreen;
+  // Disabled bodies kept per kind for reuse by the 2D scene, read when the
+  // scene is created.
+  int body_pool_size;
+  // Degrade fidelity when frames take longer than 1 / "target_fps".
+  bool governor_enabled;
+  int target_fps;
+};
+
 class Scene {
  public:
   Scene(SceneSystem *);
@@ -81,6 +154,11 @@ class SceneSystem {
   FlagsType &get_flags();
   const FlagsType &get_flags() const;
 
+  SimSettings &get_sim_settings();
+  const SimSettings &get_sim_settings() const;
+
+  DegradeLevel get_degrade_level() const;
+
   const std::deque<SceneType> *get_scene_stack() const;
   std::optional<SceneType *> get_top();
 
@@ -111,8 +189,14 @@ class SceneSystem {
   std::deque<SceneType> scene_stack;
   std::deque<Action> queued_actions;
   MapType generic_map;
+  SimSettings sim_settings;
   std::array<float, 10> dt;
   size_t dt_idx;
+  // Smoothed seconds spent in "update()" and "draw()" per frame.
+  float busy_time;
+  DegradeLevel degrade_level;
+  int governor_over_frames;
+  int governor_under_frames;
   // 0 - is fullscreen
   // 1 - moonscript loaded
   FlagsType flags;
@@ -126,6 +210,8 @@ class SceneSystem {
   uint32_t scene_type_counter;
 
   void handle_actions();
+  // Moves "degrade_level" one step at a time based on "busy_time".
+  void update_governor();
 };
 
 template <typename SceneTypeT>
@@ -21,7 +21,9 @@
 extern "C" {
 #include <lauxlib.h>
 }
+#ifdef __EMSCRIPTEN__
 #include <emscripten.h>
+#endif
 #include <rlImGui.h>
 
 // standard library includes
@@ -30,6 +32,9 @@ extern "C" {
 #include <format>
 #include <fstream>
 
+// local includes
+#include "web_util.h"
+
 extern "C" {
 
 int upload_script_to_test_lua(const char *string,
@@ -250,19 +255,7 @@ void ScriptEditScene::draw_rlimgui(SceneSystem *ctx) {
     reset_error_texts();
     std::optional<std::string> loaded = load_from_file(filename.data());
     if (loaded.has_value()) {
-      EM_ASM(const string_content = UTF8ToString($0);
-             const string_filename = UTF8ToString($1);
-             const blob = new Blob([string_content],
-                                   {
-                                     type:
-                                       'text/plain'
-                                   });
-             const url = URL.createObjectURL(blob);
-             const link = document.createElement('a'); link.href = url;
-             link.download = string_filename; document.body.appendChild(link);
-             link.click(); document.body.removeChild(link);
-             URL.revokeObjectURL(url);
-             , loaded.value().c_str(), filename.data());
+      download_text_file(filename.data(), loaded.value());
       saveload_state = ExecState::DL_SUCCESS;
     } else {
       saveload_state = ExecState::DL_FAILURE;
@@ -271,6 +264,7 @@ void ScriptEditScene::draw_rlimgui(SceneSystem *ctx) {
   ImGui::SameLine();
   if (ImGui::Button("Upload File")) {
     reset_error_texts();
+#ifdef __EMSCRIPTEN__
     EM_ASM(const file_input = document.createElement('input');
            file_input.type = 'file'; file_input.accept = '.txt,.lua,.moon';
 
@@ -291,6 +285,7 @@ void ScriptEditScene::draw_rlimgui(SceneSystem *ctx) {
                });
 
            file_input.click();, this);
+#endif
   }
   switch (saveload_state) {
     case ExecState::PENDING:
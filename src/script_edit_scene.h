@@ -161,9 +161,13 @@ const static char *DEFAULT_BALL_SCENE_SCRIPT =
     "    scene_2d.setoctagoncolor k, 140, 160, 255\n"
     "    break\n"
     "scene_2d.update = (dt) ->\n"
-    "  for k, v in pairs scene_2d.balls\n"
+    "  pos, n = scene_2d.getpositions \"ball\"\n"
+    "  for i = 1, n * 3, 3\n"
+    "    k = pos[i]\n"
+    "    v = scene_2d.balls[k]\n"
+    "    continue unless v\n"
     "    v.elapsed += dt\n"
-    "    bx, by = scene_2d.getballpos k\n"
+    "    bx, by = pos[i + 1], pos[i + 2]\n"
     "    if by > 10.0\n"
     "      scene_2d.setballpos k, 1.7, 0\n"
     "    if v.elapsed > 2.8\n"
@@ -178,9 +182,13 @@ const static char *DEFAULT_BALL_SCENE_SCRIPT =
     "        ry = math.floor(random_y * 100.0 + 0.5) / 100.0\n"
     "        print \"Ball \" .. k .. \" impulse of \" .. rx .. "
     "\", \" .. ry\n"
-    "  for k, v in pairs scene_2d.trapezoids\n"
+    "  pos, n = scene_2d.getpositions \"trapezoid\"\n"
+    "  for i = 1, n * 3, 3\n"
+    "    k = pos[i]\n"
+    "    v = scene_2d.trapezoids[k]\n"
+    "    continue unless v\n"
     "    v.elapsed += dt\n"
-    "    tx, ty = scene_2d.gettrapezoidpos k\n"
+    "    tx, ty = pos[i + 1], pos[i + 2]\n"
     "    if ty > 10.0\n"
     "      scene_2d.settrapezoidpos k, 1.7, 0\n"
     "    if v.elapsed > 2.8\n"
@@ -195,9 +203,13 @@ const static char *DEFAULT_BALL_SCENE_SCRIPT =
     "        ry = math.floor(random_y * 100.0 + 0.5) / 100.0\n"
     "        print \"Trapezoid \" .. k .. \" impulse of \" .. rx .. "
     "\", \" .. ry\n"
-    "  for k, v in pairs scene_2d.octagons\n"
+    "  pos, n = scene_2d.getpositions \"octagon\"\n"
+    "  for i = 1, n * 3, 3\n"
+    "    k = pos[i]\n"
+    "    v = scene_2d.octagons[k]\n"
+    "    continue unless v\n"
     "    v.elapsed += dt\n"
-    "    bx, by = scene_2d.getoctagonpos k\n"
+    "    bx, by = pos[i + 1], pos[i + 2]\n"
     "    if by > 10.0\n"
     "      scene_2d.setoctagonpos k, 1.7, 0\n"
     "    if v.elapsed > 2.8\n"
@@ -0,0 +1,170 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "task_pool.h"
+
+// standard library includes
+#include <algorithm>
+
+TaskPool::TaskPool(int thread_count)
+    : tasks(),
+      queues(),
+      threads(),
+      pending_chunks(0),
+      stop(false),
+      thread_count(std::clamp(thread_count, 1, get_max_thread_count())),
+      task_count(0),
+      next_queue(0) {
+  queues = std::make_unique<WorkerQueue[]>(this->thread_count);
+
+  if constexpr (TASK_POOL_HAS_THREADS) {
+    for (int idx = 1; idx < this->thread_count; ++idx) {
+      threads.emplace_back(&TaskPool::worker_loop, this,
+                           static_cast<uint32_t>(idx));
+    }
+  }
+}
+
+TaskPool::~TaskPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    stop.store(true);
+  }
+  sleep_cv.notify_all();
+
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
+
+int TaskPool::get_thread_count() const { return thread_count; }
+
+void TaskPool::begin_step() { task_count = 0; }
+
+void *TaskPool::enqueue_task(b2TaskCallback *task, int item_count,
+                             int min_range, void *task_ctx, void *user_ctx) {
+  TaskPool *pool = reinterpret_cast<TaskPool *>(user_ctx);
+
+  // Run on the calling thread if there is nobody to share with. Box2D accepts
+  // a null task as "already finished". Single item tasks are still queued,
+  // Box2D's solver relies on those running concurrently.
+  if (pool->thread_count <= 1 || pool->task_count >= TASK_POOL_MAX_TASKS) {
+    task(0, item_count, 0, task_ctx);
+    return nullptr;
+  }
+
+  const int max_chunks = pool->thread_count * TASK_POOL_CHUNKS_PER_THREAD;
+  const int chunk_count =
+      std::clamp(item_count / std::max(min_range, 1), 1, max_chunks);
+  const int chunk_size = item_count / chunk_count;
+  const int chunk_remainder = item_count % chunk_count;
+
+  Task *pool_task = &pool->tasks[pool->task_count++];
+  pool_task->callback = task;
+  pool_task->context = task_ctx;
+  pool_task->remaining.store(chunk_count);
+
+  int start = 0;
+  for (int idx = 0; idx < chunk_count; ++idx) {
+    const int end = start + chunk_size + (idx < chunk_remainder ? 1 : 0);
+    WorkerQueue &queue = pool->queues[pool->next_queue];
+    pool->next_queue = (pool->next_queue + 1) % pool->thread_count;
+    {
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.chunks.push_back(Chunk{pool_task, start, end});
+    }
+    start = end;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(pool->sleep_mutex);
+    pool->pending_chunks.fetch_add(chunk_count);
+  }
+  pool->sleep_cv.notify_all();
+
+  return pool_task;
+}
+
+void TaskPool::finish_task(void *user_task, void *user_ctx) {
+  TaskPool *pool = reinterpret_cast<TaskPool *>(user_ctx);
+  Task *task = reinterpret_cast<Task *>(user_task);
+
+  // Help out instead of blocking, the browser main thread must not sleep.
+  Chunk chunk;
+  while (task->remaining.load(std::memory_order_acquire) > 0) {
+    if (pool->try_pop(0, &chunk)) {
+      chunk.task->callback(chunk.start, chunk.end, 0, chunk.task->context);
+      chunk.task->remaining.fetch_sub(1, std::memory_order_release);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+int TaskPool::get_max_thread_count() {
+  if constexpr (TASK_POOL_HAS_THREADS) {
+    return std::max(1U, std::thread::hardware_concurrency());
+  } else {
+    return 1;
+  }
+}
+
+bool TaskPool::try_pop(uint32_t worker_idx, Chunk *out) {
+  // Own queue first, newest chunk is most likely still in cache.
+  {
+    WorkerQueue &queue = queues[worker_idx];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.chunks.empty()) {
+      *out = queue.chunks.back();
+      queue.chunks.pop_back();
+      pending_chunks.fetch_sub(1);
+      return true;
+    }
+  }
+
+  // Steal the oldest chunk from someone else.
+  for (int offset = 1; offset < thread_count; ++offset) {
+    WorkerQueue &queue = queues[(worker_idx + offset) % thread_count];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.chunks.empty()) {
+      *out = queue.chunks.front();
+      queue.chunks.pop_front();
+      pending_chunks.fetch_sub(1);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void TaskPool::worker_loop(uint32_t worker_idx) {
+  Chunk chunk;
+  while (true) {
+    if (try_pop(worker_idx, &chunk)) {
+      chunk.task->callback(chunk.start, chunk.end, worker_idx,
+                           chunk.task->context);
+      chunk.task->remaining.fetch_sub(1, std::memory_order_release);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleep_mutex);
+    sleep_cv.wait(lock,
+                  [this] { return stop.load() || pending_chunks.load() > 0; });
+    if (stop.load()) {
+      return;
+    }
+  }
+}
@@ -0,0 +1,113 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_TASK_POOL_H_
+#define SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_TASK_POOL_H_
+
+// third party includes
+#include <box2d/box2d.h>
+
+// standard library includes
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A wasm build without "-pthread" can't start threads, everything is run on
+// the calling thread instead.
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+constexpr bool TASK_POOL_HAS_THREADS = false;
+#else
+constexpr bool TASK_POOL_HAS_THREADS = true;
+#endif
+
+// Max tasks Box2D may enqueue during a single "b2World_Step".
+constexpr int TASK_POOL_MAX_TASKS = 128;
+// Tasks are split into up to this many chunks per thread so idle threads have
+// something to steal.
+constexpr int TASK_POOL_CHUNKS_PER_THREAD = 4;
+
+// Work-stealing thread pool used as Box2D's task system.
+//
+// The thread calling "b2World_Step" is worker 0 and helps execute chunks while
+// it waits in "finish_task". Every other worker owns a deque, pops from its
+// back and steals from the front of other workers' deques when empty.
+class TaskPool {
+ public:
+  // "thread_count" includes the calling thread, so 1 means single-threaded.
+  explicit TaskPool(int thread_count);
+  ~TaskPool();
+
+  // Disable copy and move, worker threads hold "this".
+  TaskPool(const TaskPool &) = delete;
+  TaskPool &operator=(const TaskPool &) = delete;
+  TaskPool(TaskPool &&) = delete;
+  TaskPool &operator=(TaskPool &&) = delete;
+
+  // Value for "b2WorldDef::workerCount".
+  int get_thread_count() const;
+
+  // Must be called before every "b2World_Step" to recycle task slots.
+  void begin_step();
+
+  // Matches "b2EnqueueTaskCallback", "user_ctx" must be a TaskPool.
+  static void *enqueue_task(b2TaskCallback *task, int item_count,
+                            int min_range, void *task_ctx, void *user_ctx);
+  // Matches "b2FinishTaskCallback", "user_ctx" must be a TaskPool.
+  static void finish_task(void *user_task, void *user_ctx);
+
+  // Upper bound for the thread count setting on this platform.
+  static int get_max_thread_count();
+
+ private:
+  struct Task {
+    b2TaskCallback *callback;
+    void *context;
+    std::atomic<int> remaining;
+  };
+
+  struct Chunk {
+    Task *task;
+    int start;
+    int end;
+  };
+
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<Chunk> chunks;
+  };
+
+  std::array<Task, TASK_POOL_MAX_TASKS> tasks;
+  std::unique_ptr<WorkerQueue[]> queues;
+  std::vector<std::thread> threads;
+  std::mutex sleep_mutex;
+  std::condition_variable sleep_cv;
+  std::atomic<int> pending_chunks;
+  std::atomic<bool> stop;
+  int thread_count;
+  int task_count;
+  uint32_t next_queue;
+
+  bool try_pop(uint32_t worker_idx, Chunk *out);
+  void worker_loop(uint32_t worker_idx);
+};
+
+#endif
@@ -0,0 +1,234 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "terrain.h"
+
+// standard library includes
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <print>
+#include <sstream>
+
+TerrainStreamer::TerrainStreamer()
+    : chunks(),
+      loaded_keys(),
+      chunk_size(TERRAIN_DEFAULT_CHUNK_SIZE),
+      friction(0.6F),
+      restitution(0.0F) {}
+
+bool TerrainStreamer::load(const std::string &path) {
+  std::ifstream ifs(path);
+  if (!ifs.good()) {
+    std::println(stdout, "WARNING: Failed to open terrain \"{}\"!", path);
+    return false;
+  }
+
+  // Parse into temporaries so a bad file leaves the current terrain.
+  float new_chunk_size = TERRAIN_DEFAULT_CHUNK_SIZE;
+  float new_friction = 0.6F;
+  float new_restitution = 0.0F;
+  std::vector<std::pair<std::vector<b2Vec2>, bool> > polylines;
+
+  std::string line;
+  for (int line_num = 1; std::getline(ifs, line); ++line_num) {
+    std::istringstream iss(line);
+    std::string keyword;
+    if (!(iss >> keyword) || keyword.starts_with('#')) {
+      continue;
+    }
+
+    bool ok = true;
+    if (keyword == "chunk_size") {
+      ok = static_cast<bool>(iss >> new_chunk_size) &&
+           new_chunk_size >= TERRAIN_MIN_CHUNK_SIZE &&
+           new_chunk_size <= TERRAIN_MAX_CHUNK_SIZE;
+    } else if (keyword == "friction") {
+      ok = static_cast<bool>(iss >> new_friction);
+    } else if (keyword == "restitution") {
+      ok = static_cast<bool>(iss >> new_restitution);
+    } else if (keyword == "chain" || keyword == "loop") {
+      std::vector<b2Vec2> points;
+      b2Vec2 point;
+      while (iss >> point.x >> point.y) {
+        points.push_back(point);
+      }
+      const bool is_loop = keyword == "loop";
+      ok = iss.eof() && points.size() >= (is_loop ? 3 : 2);
+      polylines.emplace_back(std::move(points), is_loop);
+    } else {
+      ok = false;
+    }
+
+    if (!ok) {
+      std::println(stdout, "WARNING: Terrain \"{}\" line {} is invalid!", path,
+                   line_num);
+      return false;
+    }
+  }
+
+  clear();
+  chunk_size = new_chunk_size;
+  friction = new_friction;
+  restitution = new_restitution;
+  for (const auto &[points, is_loop] : polylines) {
+    add_polyline(points, is_loop);
+  }
+
+  return true;
+}
+
+void TerrainStreamer::clear() {
+  for (int64_t key : loaded_keys) {
+    unload_chunk(chunks.at(key));
+  }
+  loaded_keys.clear();
+  chunks.clear();
+}
+
+void TerrainStreamer::update(b2WorldId world_id,
+                             const std::vector<int64_t> &wanted_keys) {
+  // Both lists are sorted, so one merge pass finds chunks to drop and chunks
+  // to create.
+  std::vector<int64_t> next_keys;
+  next_keys.reserve(wanted_keys.size());
+  auto loaded_iter = loaded_keys.begin();
+  for (int64_t key : wanted_keys) {
+    while (loaded_iter != loaded_keys.end() && *loaded_iter < key) {
+      unload_chunk(chunks.at(*loaded_iter++));
+    }
+    if (loaded_iter != loaded_keys.end() && *loaded_iter == key) {
+      ++loaded_iter;
+      next_keys.push_back(key);
+      continue;
+    }
+    if (auto iter = chunks.find(key); iter != chunks.end()) {
+      load_chunk(world_id, key, iter->second);
+      next_keys.push_back(key);
+    }
+  }
+  while (loaded_iter != loaded_keys.end()) {
+    unload_chunk(chunks.at(*loaded_iter++));
+  }
+  loaded_keys = std::move(next_keys);
+}
+
+void TerrainStreamer::draw(float pixel_ratio, Color color) const {
+  for (int64_t key : loaded_keys) {
+    for (const std::vector<b2Vec2> &chain : chunks.at(key).chains) {
+      // Skip the ghost vertices at both ends.
+      for (size_t idx = 1; idx + 2 < chain.size(); ++idx) {
+        DrawLineEx(
+            Vector2{chain[idx].x * pixel_ratio, chain[idx].y * pixel_ratio},
+            Vector2{chain[idx + 1].x * pixel_ratio,
+                    chain[idx + 1].y * pixel_ratio},
+            4.0F, color);
+      }
+    }
+  }
+}
+
+bool TerrainStreamer::empty() const { return chunks.empty(); }
+
+size_t TerrainStreamer::get_chunk_count() const { return chunks.size(); }
+
+size_t TerrainStreamer::get_loaded_count() const { return loaded_keys.size(); }
+
+int32_t TerrainStreamer::get_chunk_coord(float pos) const {
+  // Out of range floats don't convert to int, so clamp first.
+  const float coord = std::floor(pos / chunk_size);
+  if (std::isnan(coord)) {
+    return 0;
+  }
+  constexpr float max_coord = static_cast<float>(TERRAIN_MAX_CHUNK_COORD);
+  return static_cast<int32_t>(std::clamp(coord, -max_coord, max_coord));
+}
+
+int64_t TerrainStreamer::make_chunk_key(int32_t chunk_x, int32_t chunk_y) {
+  // Keys sort by x, then y.
+  return (static_cast<int64_t>(chunk_x) << 32) |
+         static_cast<int64_t>(static_cast<uint32_t>(chunk_y));
+}
+
+void TerrainStreamer::add_polyline(const std::vector<b2Vec2> &points,
+                                   bool is_loop) {
+  // "ext[i + 1]" is "points[i]". Box2D uses the first and last point of an
+  // open chain only as ghost vertices for smooth collision, so the ends get
+  // extrapolated ghosts and loops wrap around.
+  const size_t count = points.size();
+  std::vector<b2Vec2> ext;
+  ext.reserve(count + 3);
+  if (is_loop) {
+    ext.push_back(points[count - 1]);
+    ext.insert(ext.end(), points.begin(), points.end());
+    ext.push_back(points[0]);
+    ext.push_back(points[1]);
+  } else {
+    ext.push_back(b2Sub(b2MulSV(2.0F, points[0]), points[1]));
+    ext.insert(ext.end(), points.begin(), points.end());
+    ext.push_back(b2Sub(b2MulSV(2.0F, points[count - 1]), points[count - 2]));
+  }
+
+  // Segment "idx" runs from "ext[idx + 1]" to "ext[idx + 2]".
+  const size_t segment_count = ext.size() - 3;
+  size_t start = 0;
+  int64_t start_key = 0;
+  for (size_t idx = 0; idx <= segment_count; ++idx) {
+    int64_t key = start_key;
+    if (idx < segment_count) {
+      const b2Vec2 mid = b2Lerp(ext[idx + 1], ext[idx + 2], 0.5F);
+      key = make_chunk_key(get_chunk_coord(mid.x), get_chunk_coord(mid.y));
+    }
+    if (idx == 0) {
+      start_key = key;
+    } else if (idx == segment_count || key != start_key) {
+      // Segments "start" to "idx - 1" plus a ghost vertex on each side.
+      Chunk &chunk =
+          chunks.try_emplace(start_key, Chunk{{}, b2_nullBodyId, false})
+              .first->second;
+      chunk.chains.emplace_back(ext.begin() + start, ext.begin() + idx + 3);
+      start = idx;
+      start_key = key;
+    }
+  }
+}
+
+void TerrainStreamer::load_chunk(b2WorldId world_id, int64_t key,
+                                 Chunk &chunk) {
+  b2BodyDef body_def = b2DefaultBodyDef();
+  chunk.body_id = b2CreateBody(world_id, &body_def);
+
+  b2SurfaceMaterial material = b2DefaultSurfaceMaterial();
+  material.friction = friction;
+  material.restitution = restitution;
+  for (const std::vector<b2Vec2> &chain : chunk.chains) {
+    b2ChainDef chain_def = b2DefaultChainDef();
+    chain_def.points = chain.data();
+    chain_def.count = static_cast<int>(chain.size());
+    chain_def.materials = &material;
+    chain_def.materialCount = 1;
+    b2CreateChain(chunk.body_id, &chain_def);
+  }
+  chunk.loaded = true;
+}
+
+void TerrainStreamer::unload_chunk(Chunk &chunk) {
+  if (chunk.loaded) {
+    b2DestroyBody(chunk.body_id);
+    chunk.loaded = false;
+  }
+}
@@ -0,0 +1,108 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_TERRAIN_H_
+#define SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_TERRAIN_H_
+
+// third party includes
+#include <box2d/box2d.h>
+#include <raylib.h>
+
+// standard library includes
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// MEMFS directory for terrain files loaded from Lua.
+constexpr const char *TERRAIN_DIR = "/terrain";
+constexpr float TERRAIN_DEFAULT_CHUNK_SIZE = 4.0F;
+// Bounds of "chunk_size" in terrain files.
+constexpr float TERRAIN_MIN_CHUNK_SIZE = 0.25F;
+constexpr float TERRAIN_MAX_CHUNK_SIZE = 1024.0F;
+// Chunk coordinates are clamped to this magnitude, so neighbours of any
+// chunk still fit in an int32_t.
+constexpr int32_t TERRAIN_MAX_CHUNK_COORD = 1 << 30;
+// Chunks this many chunks around the view and around each body stay loaded.
+constexpr int TERRAIN_CHUNK_MARGIN = 1;
+// Upper bound on chunks per axis kept around the view when zoomed far out.
+constexpr int TERRAIN_MAX_VIEW_CHUNKS = 32;
+// Updates between recomputing which chunks are needed. Each body's chunks
+// reach as far as its velocity carries it in that time.
+constexpr int TERRAIN_REFRESH_INTERVAL = 10;
+// Upper bound on chunks per axis a body's velocity adds ahead of it.
+constexpr int TERRAIN_MAX_BODY_CHUNKS = 16;
+
+// Static terrain split into square chunks of chain shapes. Only chunks asked
+// for by "update(...)" have a Box2D body, the rest are just vertex data.
+//
+// Terrain files are text, one statement per line ("#" starts a comment):
+//   chunk_size <size>               (0.25 to 1024, default 4)
+//   friction <value>
+//   restitution <value>
+//   chain <x0> <y0> <x1> <y1> ...   (open polyline, at least 2 points)
+//   loop <x0> <y0> <x1> <y1> ...    (closed polygon, at least 3 points)
+// Coordinates are in Box2D units. Settings apply to the whole file. Chains are
+// one-sided: a chain running left to right is solid from above on screen,
+// loops should be listed clockwise as seen on screen.
+class TerrainStreamer {
+ public:
+  TerrainStreamer();
+
+  // Replaces the terrain with the file's contents, destroying chunk bodies
+  // of the old terrain. Returns false and keeps the old terrain if the file
+  // is missing or malformed.
+  bool load(const std::string &path);
+  // Destroys every chunk body and forgets the terrain.
+  void clear();
+
+  // "wanted_keys" must be sorted and unique. Chunks in it get bodies, loaded
+  // chunks not in it are destroyed.
+  void update(b2WorldId world_id, const std::vector<int64_t> &wanted_keys);
+
+  // Draws the chains of loaded chunks, in pixels.
+  void draw(float pixel_ratio, Color color) const;
+
+  bool empty() const;
+  size_t get_chunk_count() const;
+  size_t get_loaded_count() const;
+  int32_t get_chunk_coord(float pos) const;
+
+  static int64_t make_chunk_key(int32_t chunk_x, int32_t chunk_y);
+
+ private:
+  struct Chunk {
+    // Each chain includes a ghost vertex at both ends, see "add_polyline".
+    std::vector<std::vector<b2Vec2> > chains;
+    b2BodyId body_id;
+    bool loaded;
+  };
+
+  std::unordered_map<int64_t, Chunk> chunks;
+  // Sorted keys of chunks with a body.
+  std::vector<int64_t> loaded_keys;
+  float chunk_size;
+  float friction;
+  float restitution;
+
+  // Splits a polyline at chunk borders. Each segment goes to the chunk
+  // holding its midpoint.
+  void add_polyline(const std::vector<b2Vec2> &points, bool is_loop);
+  void load_chunk(b2WorldId world_id, int64_t key, Chunk &chunk);
+  static void unload_chunk(Chunk &chunk);
+};
+
+#endif
@@ -0,0 +1,48 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "timing_stats.h"
+
+// standard library includes
+#include <algorithm>
+
+namespace {
+
+// Nearest-rank percentile, "sorted" must not be empty.
+float percentile(const std::vector<float> &sorted, float pct) {
+  const size_t rank = static_cast<size_t>(
+      pct / 100.0F * static_cast<float>(sorted.size() - 1) + 0.5F);
+  return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+}  // namespace
+
+TimingStats compute_timing_stats(std::vector<float> *samples) {
+  if (samples->empty()) {
+    return TimingStats{0.0F, 0.0F, 0.0F, 0.0F, 0.0F};
+  }
+
+  std::sort(samples->begin(), samples->end());
+  double total = 0.0;
+  for (float sample : *samples) {
+    total += sample;
+  }
+
+  return TimingStats{
+      static_cast<float>(total / static_cast<double>(samples->size())),
+      percentile(*samples, 50.0F), percentile(*samples, 90.0F),
+      percentile(*samples, 99.0F), samples->back()};
+}
@@ -0,0 +1,35 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_TIMING_STATS_H_
+#define SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_TIMING_STATS_H_
+
+// standard library includes
+#include <vector>
+
+// Summary of a series of durations, in the unit of the samples.
+struct TimingStats {
+  float mean;
+  float p50;
+  float p90;
+  float p99;
+  float max;
+};
+
+// Sorts "samples" in place. Returns all zeroes if "samples" is empty.
+TimingStats compute_timing_stats(std::vector<float> *samples);
+
+#endif
@@ -0,0 +1,170 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "vertex_transform.h"
+
+// third party includes
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// standard library includes
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// Both paths evaluate "(p + c * x - s * y) * scale" in the same order with
+// separate multiplies and adds, so they round identically. Don't rewrite as
+// fused multiply-add in one path only. The Makefile builds this file with
+// "-ffp-contract=off" so the compiler doesn't fuse them either, GCC would by
+// default on FMA capable targets such as aarch64.
+
+void transform_vertices_scalar(const b2Transform *transforms, size_t count,
+                               const b2Vec2 *local, int vertex_count,
+                               float scale, Vector2 *out) {
+  for (size_t body = 0; body < count; ++body) {
+    const b2Transform &tr = transforms[body];
+    for (int idx = 0; idx < vertex_count; ++idx) {
+      const float cx = tr.q.c * local[idx].x;
+      const float sy = tr.q.s * local[idx].y;
+      const float sx = tr.q.s * local[idx].x;
+      const float cy = tr.q.c * local[idx].y;
+      out->x = ((tr.p.x + cx) - sy) * scale;
+      out->y = ((tr.p.y + sx) + cy) * scale;
+      ++out;
+    }
+  }
+}
+
+#if defined(__wasm_simd128__) || defined(__SSE2__) || defined(__ARM_NEON)
+
+#if defined(__wasm_simd128__)
+using f32x4 = v128_t;
+static inline f32x4 f32x4_load(const float *ptr) { return wasm_v128_load(ptr); }
+static inline void f32x4_store(float *ptr, f32x4 v) { wasm_v128_store(ptr, v); }
+static inline f32x4 f32x4_splat(float value) { return wasm_f32x4_splat(value); }
+static inline f32x4 f32x4_add(f32x4 a, f32x4 b) { return wasm_f32x4_add(a, b); }
+static inline f32x4 f32x4_sub(f32x4 a, f32x4 b) { return wasm_f32x4_sub(a, b); }
+static inline f32x4 f32x4_mul(f32x4 a, f32x4 b) { return wasm_f32x4_mul(a, b); }
+#elif defined(__SSE2__)
+using f32x4 = __m128;
+static inline f32x4 f32x4_load(const float *ptr) { return _mm_loadu_ps(ptr); }
+static inline void f32x4_store(float *ptr, f32x4 v) { _mm_storeu_ps(ptr, v); }
+static inline f32x4 f32x4_splat(float value) { return _mm_set1_ps(value); }
+static inline f32x4 f32x4_add(f32x4 a, f32x4 b) { return _mm_add_ps(a, b); }
+static inline f32x4 f32x4_sub(f32x4 a, f32x4 b) { return _mm_sub_ps(a, b); }
+static inline f32x4 f32x4_mul(f32x4 a, f32x4 b) { return _mm_mul_ps(a, b); }
+#else
+using f32x4 = float32x4_t;
+static inline f32x4 f32x4_load(const float *ptr) { return vld1q_f32(ptr); }
+static inline void f32x4_store(float *ptr, f32x4 v) { vst1q_f32(ptr, v); }
+static inline f32x4 f32x4_splat(float value) { return vdupq_n_f32(value); }
+static inline f32x4 f32x4_add(f32x4 a, f32x4 b) { return vaddq_f32(a, b); }
+static inline f32x4 f32x4_sub(f32x4 a, f32x4 b) { return vsubq_f32(a, b); }
+static inline f32x4 f32x4_mul(f32x4 a, f32x4 b) { return vmulq_f32(a, b); }
+#endif
+
+void transform_vertices(const b2Transform *transforms, size_t count,
+                        const b2Vec2 *local, int vertex_count, float scale,
+                        Vector2 *out) {
+  const f32x4 scale_v = f32x4_splat(scale);
+  float px[4];
+  float py[4];
+  float c[4];
+  float s[4];
+  float x[4];
+  float y[4];
+
+  size_t body = 0;
+  for (; body + 4 <= count; body += 4) {
+    // Gather the four transforms into one lane per body.
+    for (int lane = 0; lane < 4; ++lane) {
+      const b2Transform &tr = transforms[body + lane];
+      px[lane] = tr.p.x;
+      py[lane] = tr.p.y;
+      c[lane] = tr.q.c;
+      s[lane] = tr.q.s;
+    }
+    const f32x4 px_v = f32x4_load(px);
+    const f32x4 py_v = f32x4_load(py);
+    const f32x4 c_v = f32x4_load(c);
+    const f32x4 s_v = f32x4_load(s);
+
+    for (int idx = 0; idx < vertex_count; ++idx) {
+      const f32x4 lx = f32x4_splat(local[idx].x);
+      const f32x4 ly = f32x4_splat(local[idx].y);
+      const f32x4 x_v = f32x4_mul(
+          f32x4_sub(f32x4_add(px_v, f32x4_mul(c_v, lx)), f32x4_mul(s_v, ly)),
+          scale_v);
+      const f32x4 y_v = f32x4_mul(
+          f32x4_add(f32x4_add(py_v, f32x4_mul(s_v, lx)), f32x4_mul(c_v, ly)),
+          scale_v);
+      f32x4_store(x, x_v);
+      f32x4_store(y, y_v);
+      for (int lane = 0; lane < 4; ++lane) {
+        out[(body + lane) * vertex_count + idx] = Vector2{x[lane], y[lane]};
+      }
+    }
+  }
+
+  // Leftover bodies.
+  transform_vertices_scalar(transforms + body, count - body, local,
+                            vertex_count, scale, out + body * vertex_count);
+}
+
+#else
+
+void transform_vertices(const b2Transform *transforms, size_t count,
+                        const b2Vec2 *local, int vertex_count, float scale,
+                        Vector2 *out) {
+  transform_vertices_scalar(transforms, count, local, vertex_count, scale, out);
+}
+
+#endif
+
+bool vertex_transform_self_check() {
+  // Odd body count so the scalar tail is covered too.
+  constexpr size_t BODY_COUNT = 37;
+  constexpr int VERTEX_COUNT = 8;
+
+  std::vector<b2Transform> transforms(BODY_COUNT);
+  for (size_t body = 0; body < BODY_COUNT; ++body) {
+    const float angle = static_cast<float>(body) * 0.37F;
+    transforms[body] = b2Transform{
+        b2Vec2{static_cast<float>(body) * 0.13F - 2.0F,
+               static_cast<float>(body) * -0.07F + 1.0F},
+        b2MakeRot(angle)};
+  }
+  b2Vec2 local[VERTEX_COUNT];
+  for (int idx = 0; idx < VERTEX_COUNT; ++idx) {
+    const float angle = static_cast<float>(idx) * 0.785F;
+    local[idx] = b2Vec2{std::cos(angle) * 0.1F, std::sin(angle) * 0.1F};
+  }
+
+  std::vector<Vector2> simd_out(BODY_COUNT * VERTEX_COUNT);
+  std::vector<Vector2> scalar_out(BODY_COUNT * VERTEX_COUNT);
+  transform_vertices(transforms.data(), BODY_COUNT, local, VERTEX_COUNT,
+                     200.0F, simd_out.data());
+  transform_vertices_scalar(transforms.data(), BODY_COUNT, local,
+                            VERTEX_COUNT, 200.0F, scalar_out.data());
+
+  return std::memcmp(simd_out.data(), scalar_out.data(),
+                     simd_out.size() * sizeof(Vector2)) == 0;
+}
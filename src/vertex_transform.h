@@ -0,0 +1,55 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_VERTEX_TRANSFORM_H_
+#define SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_VERTEX_TRANSFORM_H_
+
+// third party includes
+#include <box2d/box2d.h>
+#include <raylib.h>
+
+// standard library includes
+#include <cstddef>
+
+#if defined(__wasm_simd128__)
+constexpr const char *VERTEX_TRANSFORM_SIMD_NAME = "wasm simd128";
+#elif defined(__SSE2__)
+constexpr const char *VERTEX_TRANSFORM_SIMD_NAME = "SSE2";
+#elif defined(__ARM_NEON)
+constexpr const char *VERTEX_TRANSFORM_SIMD_NAME = "NEON";
+#else
+constexpr const char *VERTEX_TRANSFORM_SIMD_NAME = nullptr;
+#endif
+
+// Applies every transform in "transforms" to the same "vertex_count" local
+// vertices and scales the result by "scale" (e.g. pixels per Box2D unit).
+// "out" receives "count * vertex_count" vertices, grouped by body.
+//
+// Uses SIMD when the build enables it, four bodies at a time. Results are
+// bit-identical to "transform_vertices_scalar(...)".
+void transform_vertices(const b2Transform *transforms, size_t count,
+                        const b2Vec2 *local, int vertex_count, float scale,
+                        Vector2 *out);
+
+void transform_vertices_scalar(const b2Transform *transforms, size_t count,
+                               const b2Vec2 *local, int vertex_count,
+                               float scale, Vector2 *out);
+
+// Compares both paths on generated input, returns false on any mismatch.
+// Only meaningful when "VERTEX_TRANSFORM_SIMD_NAME" isn't null.
+bool vertex_transform_self_check();
+
+#endif
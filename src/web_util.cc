@@ -0,0 +1,78 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "web_util.h"
+
+// third party includes
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#endif
+
+// standard library includes
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <print>
+
+// local includes
+#include "scene_system.h"
+
+#ifdef __EMSCRIPTEN__
+// The runtime only keeps library functions something asks for.
+EM_JS_DEPS(web_util, "$stringToNewUTF8");
+EM_JS(char *, web_util_get_user_agent, (),
+      { return stringToNewUTF8(navigator.userAgent); });
+#endif
+
+void download_text_file(const std::string &filename,
+                        const std::string &content) {
+#ifdef __EMSCRIPTEN__
+  EM_ASM(const string_content = UTF8ToString($0);
+         const string_filename = UTF8ToString($1);
+         const blob = new Blob([string_content],
+                               {
+                                 type:
+                                   'text/plain'
+                               });
+         const url = URL.createObjectURL(blob);
+         const link = document.createElement('a'); link.href = url;
+         link.download = string_filename; document.body.appendChild(link);
+         link.click(); document.body.removeChild(link);
+         URL.revokeObjectURL(url);
+         , content.c_str(), filename.c_str());
+#else
+  const std::filesystem::path dir = std::format("{}/downloads", FS_ROOT);
+  std::error_code err;
+  std::filesystem::create_directories(dir, err);
+  const std::filesystem::path path =
+      dir / std::filesystem::path(filename).filename();
+  std::ofstream ofs(path, std::ios_base::out | std::ios_base::trunc);
+  ofs << content;
+  std::println(stdout, "Wrote \"{}\".", path.string());
+#endif
+}
+
+std::string get_user_agent() {
+#ifdef __EMSCRIPTEN__
+  char *user_agent = web_util_get_user_agent();
+  std::string ret = user_agent;
+  std::free(user_agent);
+  return ret;
+#else
+  return "native";
+#endif
+}
@@ -0,0 +1,31 @@
+// ISC License
+//
+// Copyright (c) 2025-2026 Stephen Seo
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+// REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+// AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+// LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+// OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#ifndef SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_WEB_UTIL_H_
+#define SEODISPARATE_COM_JUMPARTIFACT_DEMO_1_WEB_UTIL_H_
+
+// standard library includes
+#include <string>
+
+// Lets the browser download "content" as "filename" through a Blob. Native
+// builds write it to "downloads/<filename>" under FS_ROOT instead.
+void download_text_file(const std::string &filename,
+                        const std::string &content);
+
+// "navigator.userAgent", or "native" outside the browser.
+std::string get_user_agent();
+
+#endif